@@ -24,6 +24,7 @@
 #include <cmath>
 #include <stdio.h>
 #include "FX.h"
+#include "capabilities.h"
 
 #ifdef BE_WS_X11
 #if QT_VERSION >= 0x060200
@@ -35,7 +36,6 @@
 #include <X11/Xatom.h>
 #include "xproperty.h"
 #include "fixx11h.h"
-namespace BE { namespace FX { static Atom net_wm_cm; } }
 #endif
 
 using namespace BE;
@@ -257,16 +257,9 @@ FX::expblur(QImage &img, int radius, Qt::Orientations o)
 }
 // ======================================================
 
-// stolen from KWindowSystem
 bool FX::compositingActive()
 {
-#ifdef BE_WS_X11
-    if (!BE::isPlatformX11())
-        return true; // we assume wayland - or any other compositing capable display server
-    return XGetSelectionOwner( BE_X11_DISPLAY, BE::FX::net_wm_cm ) != None;
-#else
-    return true;
-#endif
+    return Capabilities::compositing();
 }
 
 static bool useRaster = false;
@@ -274,14 +267,7 @@ static bool useRaster = false;
 void
 FX::init()
 {
-#ifdef BE_WS_X11
-    if (!BE::isPlatformX11())
-        return;
-    Display *dpy = BE_X11_DISPLAY;
-    char string[ 100 ];
-    sprintf(string, "_NET_WM_CM_S%d", DefaultScreen( dpy ));
-    BE::FX::net_wm_cm = XInternAtom(dpy, string, False);
-#endif
+    Capabilities::instance(); // starts monitoring
 }
 
 bool
@@ -74,6 +74,43 @@ Hover::managesArea(QWidget *area)
     return instance->_scrollAreas.contains(area);
 }
 
+bool
+Hover::isArea(const QObject *o) const
+{
+    return qobject_cast<const QAbstractScrollArea*>(o) || _scrollAreas.contains(const_cast<QObject*>(o));
+}
+
+/**
+ * Whether the mouse is over the area, but not over some nested scrollable area
+ * This is tracked from Enter/Leave events, see eventFilter
+ */
+bool
+Hover::hoversArea(const QWidget *area)
+{
+    if (!area->underMouse())
+        return false;
+    if (!instance)
+        return true;
+    const QWidget *hovered = instance->_hoveredArea.data();
+    if (!hovered || hovered == area || !hovered->underMouse() || !area->isAncestorOf(hovered))
+        return true;
+    for (const QWidget *w = hovered; w && w != area; w = w->parentWidget()) {
+        const QAbstractScrollArea *nested = qobject_cast<const QAbstractScrollArea*>(w);
+        if (!nested || nested->testAttribute(Qt::WA_TransparentForMouseEvents))
+            continue;
+        if (nested->geometry().y() < -400000)
+            continue; // khtmlview and some other widget set off a render dummy
+        int d = 0;
+        if (QScrollBar *bar = nested->verticalScrollBar())
+            d += bar->maximum() - bar->minimum();
+        if (QScrollBar *bar = nested->horizontalScrollBar())
+            d += bar->maximum() - bar->minimum();
+        if (d)
+            return false;
+    }
+    return true;
+}
+
 bool
 Hover::manageScrollArea(QWidget *area)
 {
@@ -198,6 +235,9 @@ Hover::eventFilter( QObject* object, QEvent *e )
     switch (e->type()) {
     case QEvent::WindowActivate:
     case QEvent::Enter: {
+        // parents get the enter before their children, so the last one is the innermost
+        if (e->type() == QEvent::Enter && isArea(object))
+            _hoveredArea = static_cast<QWidget*>(object);
         if (QAbstractScrollArea* area = qobject_cast<QAbstractScrollArea*>(object)) {
             if (!area->isEnabled())
                 return false;
@@ -220,6 +260,12 @@ Hover::eventFilter( QObject* object, QEvent *e )
     }
     case QEvent::WindowDeactivate:
     case QEvent::Leave: {
+        if (e->type() == QEvent::Leave && object == _hoveredArea.data()) {
+            QWidget *area = _hoveredArea.data()->parentWidget();
+            while (area && !(isArea(area) && area->underMouse()))
+                area = area->parentWidget();
+            _hoveredArea = area;
+        }
         if (QAbstractScrollArea* area = qobject_cast<QAbstractScrollArea*>(object)) {
             if (!area->isEnabled())
                 return false;
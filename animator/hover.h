@@ -28,6 +28,7 @@ Q_OBJECT
     public:
     static bool manage(QWidget *w, bool isScrollArea = false);
     static bool managesArea(QWidget *area);
+    static bool hoversArea(const QWidget *area);
     static void release(QWidget *w);
     static void setDuration(uint ms);
     static void setFPS(uint fps);
@@ -37,6 +38,7 @@ Q_OBJECT
 protected:
     Hover();
     virtual bool manageScrollArea(QWidget *w);
+    bool isArea(const QObject *o) const;
     void _setFPS(uint fps);
     virtual int _step(const QWidget *widget, long int index = 0) const;
     virtual void play(QWidget *widget, bool bwd = false);
@@ -46,6 +48,7 @@ protected slots:
 private:
     Q_DISABLE_COPY(Hover)
     QObjectList _scrollAreas;
+    WidgetPtr _hoveredArea; // the innermost area under the mouse
 };
 
 }
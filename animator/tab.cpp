@@ -58,6 +58,9 @@ scrollAncestor(QWidget *w, QWidget *root)
     return 0L;
 }
 
+// renders into pixmaps go on, see Tab::isGrabbing()
+static bool s_grabbing = false;
+
 // to get an idea about what the bg of out tabs looks like - seems as if we
 // need to paint it
 static QPixmap
@@ -105,6 +108,7 @@ dumpBackground(QWidget *target, const QRect &r, const QStyle *style, bool _32bit
 
     QPoint zero(0,0);
     QPaintEvent e(r); int i = widgets.size();
+    s_grabbing = true;
     while (i)
     {
         w = widgets.at(--i);
@@ -118,6 +122,7 @@ dumpBackground(QWidget *target, const QRect &r, const QStyle *style, bool _32bit
         QPainter::restoreRedirected(w);
 #endif
     }
+    s_grabbing = false;
     return pix;
 }
 
@@ -132,6 +137,7 @@ grabWidget(QWidget * root, QPixmap &pix)
     if (!root)
         return;
 
+    s_grabbing = true;
     QPoint zero(0,0);
 //     QSize sz = root->window()->size();
 
@@ -242,6 +248,7 @@ grabWidget(QWidget * root, QPixmap &pix)
         }
     }
     delete saPix;
+    s_grabbing = false;
 }
 
 static uint _duration = 350;
@@ -540,6 +547,12 @@ TabInfo::updatePixmaps(Transition transition, uint ms)
    }
 }
 
+bool
+Tab::isGrabbing()
+{
+    return s_grabbing;
+}
+
 void
 Tab::setDuration(uint ms)
 {
@@ -66,6 +66,8 @@ public:
     static void setDuration(uint ms);
     static void setFPS(uint fps);
     static void setTransition(Transition t);
+    // whether widgets are currently rendered into the transition pixmaps, ie. not to screen
+    static bool isGrabbing();
 protected:
     Tab();
     virtual bool _manage(QWidget *w);
@@ -0,0 +1,481 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+/**
+ * Offscreen paint benchmark
+ *
+ * Walks every element that has a routine registered by Style::registerRoutines()
+ * and paints it into a QImage for a matrix of states, sizes and palettes.
+ * Reports ns/op and heap allocations/op per element, optionally writes the
+ * result as JSON and compares it against a previous run (the baseline).
+ *
+ * virtuality-bench [--style name] [--iterations n] [--output file.json]
+ *                  [--baseline file.json] [--tolerance percent] [--filter substring]
+ *
+ * Exits 1 if any element got slower than the tolerance or allocates more
+ * than in the baseline.
+ */
+
+#include <QAbstractSpinBox>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFrame>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMetaEnum>
+#include <QPainter>
+#include <QScopedPointer>
+#include <QStringList>
+#include <QStyleOption>
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "virtuality.h"
+
+// allocation counting ------------------------------------------------------------
+// replacing the global operators in the executable catches the plugin as well
+
+static unsigned long gs_allocations = 0;
+
+void *operator new(std::size_t size)
+{
+    ++gs_allocations;
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+// the matrix --------------------------------------------------------------------
+
+struct State { const char *name; QStyle::State flags; };
+static const State states[] = {
+    { "normal", QStyle::State_Enabled },
+    { "hover", QStyle::State_Enabled | QStyle::State_MouseOver },
+    { "sunken", QStyle::State_Enabled | QStyle::State_Sunken },
+    { "focus", QStyle::State_Enabled | QStyle::State_HasFocus },
+    { "disabled", QStyle::State_None }
+};
+static const QSize sizes[] = { QSize(16, 16), QSize(120, 28), QSize(320, 200) };
+enum { N_STATES = sizeof(states)/sizeof(State), N_SIZES = sizeof(sizes)/sizeof(QSize), N_PALETTES = 2 };
+
+static QPalette
+palette(const QStyle *style, int index)
+{
+    if (!index)
+        return style->standardPalette();
+    // generated dark palette to catch contrast dependent code paths
+    QPalette pal(QColor(48, 50, 54), QColor(32, 33, 36));
+    const_cast<QStyle*>(style)->polish(pal);
+    return pal;
+}
+
+// options -----------------------------------------------------------------------
+
+enum Kind { PE = BE::Style::PrimitiveRoutine, CE = BE::Style::ControlRoutine, CC = BE::Style::ComplexRoutine };
+
+static QStyleOption *
+createOption(Kind kind, int element)
+{
+    if (kind == PE) {
+        switch (element) {
+        case QStyle::PE_PanelButtonCommand:
+        case QStyle::PE_PanelButtonBevel:
+        case QStyle::PE_IndicatorCheckBox:
+        case QStyle::PE_IndicatorRadioButton: {
+            QStyleOptionButton *opt = new QStyleOptionButton;
+            opt->text = "Button";
+            return opt;
+        }
+        case QStyle::PE_Frame:
+        case QStyle::PE_FrameLineEdit:
+        case QStyle::PE_PanelLineEdit:
+        case QStyle::PE_FrameGroupBox:
+        case QStyle::PE_FrameDockWidget: {
+            QStyleOptionFrame *opt = new QStyleOptionFrame;
+            opt->lineWidth = 1;
+            return opt;
+        }
+        case QStyle::PE_FrameTabWidget:
+            return new QStyleOptionTabWidgetFrame;
+        case QStyle::PE_FrameTabBarBase:
+            return new QStyleOptionTabBarBase;
+        case QStyle::PE_IndicatorHeaderArrow: {
+            QStyleOptionHeader *opt = new QStyleOptionHeader;
+            opt->sortIndicator = QStyleOptionHeader::SortDown;
+            return opt;
+        }
+        case QStyle::PE_IndicatorItemViewItemCheck:
+        case QStyle::PE_PanelItemViewItem:
+        case QStyle::PE_PanelItemViewRow: {
+            QStyleOptionViewItem *opt = new QStyleOptionViewItem;
+            opt->features = QStyleOptionViewItem::HasCheckIndicator;
+            opt->checkState = Qt::Checked;
+            return opt;
+        }
+        case QStyle::PE_IndicatorMenuCheckMark:
+            return new QStyleOptionMenuItem;
+        default:
+            return new QStyleOption;
+        }
+    }
+    if (kind == CE) {
+        switch (element) {
+        case QStyle::CE_PushButton:
+        case QStyle::CE_PushButtonBevel:
+        case QStyle::CE_PushButtonLabel:
+        case QStyle::CE_CheckBox:
+        case QStyle::CE_RadioButton:
+        case QStyle::CE_CheckBoxLabel:
+        case QStyle::CE_RadioButtonLabel: {
+            QStyleOptionButton *opt = new QStyleOptionButton;
+            opt->text = "Button";
+            return opt;
+        }
+        case QStyle::CE_DockWidgetTitle: {
+            QStyleOptionDockWidget *opt = new QStyleOptionDockWidget;
+            opt->title = "Dock";
+            opt->closable = opt->movable = opt->floatable = true;
+            return opt;
+        }
+        case QStyle::CE_ShapedFrame: {
+            QStyleOptionFrame *opt = new QStyleOptionFrame;
+            opt->frameShape = QFrame::StyledPanel;
+            opt->lineWidth = 1;
+            return opt;
+        }
+        case QStyle::CE_ComboBoxLabel: {
+            QStyleOptionComboBox *opt = new QStyleOptionComboBox;
+            opt->currentText = "Combo";
+            return opt;
+        }
+        case QStyle::CE_MenuBarItem:
+        case QStyle::CE_MenuItem:
+        case QStyle::CE_MenuScroller:
+        case QStyle::CE_MenuTearoff: {
+            QStyleOptionMenuItem *opt = new QStyleOptionMenuItem;
+            opt->menuItemType = QStyleOptionMenuItem::Normal;
+            opt->text = "Menu\tCtrl+M";
+            return opt;
+        }
+        case QStyle::CE_ProgressBar:
+        case QStyle::CE_ProgressBarGroove:
+        case QStyle::CE_ProgressBarContents:
+        case QStyle::CE_ProgressBarLabel: {
+            QStyleOptionProgressBar *opt = new QStyleOptionProgressBar;
+            opt->minimum = 0; opt->maximum = 100; opt->progress = 42;
+            opt->text = "42%"; opt->textVisible = true;
+            return opt;
+        }
+        case QStyle::CE_ScrollBarAddLine:
+        case QStyle::CE_ScrollBarSubLine:
+        case QStyle::CE_ScrollBarSlider: {
+            QStyleOptionSlider *opt = new QStyleOptionSlider;
+            opt->minimum = 0; opt->maximum = 100; opt->sliderPosition = opt->sliderValue = 30;
+            opt->pageStep = 10;
+            return opt;
+        }
+        case QStyle::CE_TabBarTab:
+        case QStyle::CE_TabBarTabShape:
+        case QStyle::CE_TabBarTabLabel: {
+            QStyleOptionTab *opt = new QStyleOptionTab;
+            opt->text = "Tab";
+            opt->position = QStyleOptionTab::Middle;
+            return opt;
+        }
+        case QStyle::CE_ToolBoxTab:
+        case QStyle::CE_ToolBoxTabShape:
+        case QStyle::CE_ToolBoxTabLabel: {
+            QStyleOptionToolBox *opt = new QStyleOptionToolBox;
+            opt->text = "Page";
+            return opt;
+        }
+        case QStyle::CE_ToolButtonLabel: {
+            QStyleOptionToolButton *opt = new QStyleOptionToolButton;
+            opt->text = "Tool";
+            opt->toolButtonStyle = Qt::ToolButtonTextOnly;
+            return opt;
+        }
+        case QStyle::CE_Header:
+        case QStyle::CE_HeaderSection:
+        case QStyle::CE_HeaderLabel: {
+            QStyleOptionHeader *opt = new QStyleOptionHeader;
+            opt->text = "Header";
+            opt->position = QStyleOptionHeader::Middle;
+            opt->sortIndicator = QStyleOptionHeader::SortUp;
+            return opt;
+        }
+        case QStyle::CE_RubberBand:
+            return new QStyleOptionRubberBand;
+        case QStyle::CE_SizeGrip:
+            return new QStyleOptionSizeGrip;
+        case QStyle::CE_ToolBar:
+            return new QStyleOptionToolBar;
+        default:
+            return new QStyleOption;
+        }
+    }
+    switch (element) {
+    case QStyle::CC_ScrollBar:
+    case QStyle::CC_Slider:
+    case QStyle::CC_Dial: {
+        QStyleOptionSlider *opt = new QStyleOptionSlider;
+        opt->minimum = 0; opt->maximum = 100; opt->sliderPosition = opt->sliderValue = 30;
+        opt->pageStep = 10;
+        opt->subControls = QStyle::SC_All;
+        return opt;
+    }
+    case QStyle::CC_SpinBox: {
+        QStyleOptionSpinBox *opt = new QStyleOptionSpinBox;
+        opt->subControls = QStyle::SC_All;
+        opt->stepEnabled = QAbstractSpinBox::StepUpEnabled | QAbstractSpinBox::StepDownEnabled;
+        return opt;
+    }
+    case QStyle::CC_ComboBox: {
+        QStyleOptionComboBox *opt = new QStyleOptionComboBox;
+        opt->subControls = QStyle::SC_All;
+        opt->currentText = "Combo";
+        return opt;
+    }
+    case QStyle::CC_GroupBox: {
+        QStyleOptionGroupBox *opt = new QStyleOptionGroupBox;
+        opt->subControls = QStyle::SC_GroupBoxFrame | QStyle::SC_GroupBoxLabel;
+        opt->text = "Group";
+        return opt;
+    }
+    case QStyle::CC_ToolButton: {
+        QStyleOptionToolButton *opt = new QStyleOptionToolButton;
+        opt->subControls = QStyle::SC_ToolButton;
+        opt->text = "Tool";
+        opt->toolButtonStyle = Qt::ToolButtonTextOnly;
+        return opt;
+    }
+    case QStyle::CC_TitleBar: {
+        QStyleOptionTitleBar *opt = new QStyleOptionTitleBar;
+        opt->subControls = QStyle::SC_All;
+        opt->titleBarFlags = Qt::Window | Qt::WindowTitleHint | Qt::WindowSystemMenuHint |
+                             Qt::WindowMinMaxButtonsHint | Qt::WindowCloseButtonHint;
+        opt->text = "Title";
+        return opt;
+    }
+    default: {
+        QStyleOptionComplex *opt = new QStyleOptionComplex;
+        opt->subControls = QStyle::SC_All;
+        return opt;
+    }
+    }
+}
+
+static QString
+elementName(Kind kind, int element)
+{
+    const char *key = 0;
+#if QT_VERSION >= 0x050500
+    if (kind == PE)
+        key = QMetaEnum::fromType<QStyle::PrimitiveElement>().valueToKey(element);
+    else if (kind == CE)
+        key = QMetaEnum::fromType<QStyle::ControlElement>().valueToKey(element);
+    else
+        key = QMetaEnum::fromType<QStyle::ComplexControl>().valueToKey(element);
+#endif
+    if (key)
+        return QString::fromLatin1(key);
+    static const char *prefix[3] = { "PE_", "CE_", "CC_" };
+    return QString::fromLatin1(prefix[kind]) + QString::number(element);
+}
+
+// measuring ---------------------------------------------------------------------
+
+struct Result {
+    QString name;
+    double nsPerOp;
+    double allocsPerOp;
+};
+
+static inline void
+paint(const QStyle *style, Kind kind, int element, const QStyleOption *opt, QPainter *p)
+{
+    if (kind == PE)
+        style->drawPrimitive(QStyle::PrimitiveElement(element), opt, p, 0);
+    else if (kind == CE)
+        style->drawControl(QStyle::ControlElement(element), opt, p, 0);
+    else
+        style->drawComplexControl(QStyle::ComplexControl(element), static_cast<const QStyleOptionComplex*>(opt), p, 0);
+}
+
+static Result
+measure(const QStyle *style, Kind kind, int element, int iterations, const QPalette *palettes, QImage *canvas)
+{
+    Result result = { elementName(kind, element), 0.0, 0.0 };
+    QScopedPointer<QStyleOption> opt(createOption(kind, element));
+    opt->direction = Qt::LeftToRight;
+    opt->fontMetrics = QFontMetrics(QApplication::font());
+
+    qint64 ns = 0;
+    unsigned long allocs = 0;
+    int ops = 0;
+    QElapsedTimer timer;
+    for (int pal = 0; pal < N_PALETTES; ++pal) {
+        opt->palette = palettes[pal];
+        for (int sz = 0; sz < N_SIZES; ++sz) {
+            opt->rect = QRect(QPoint(4, 4), sizes[sz]);
+            for (int st = 0; st < N_STATES; ++st) {
+                opt->state = states[st].flags | QStyle::State_Horizontal;
+                canvas->fill(Qt::transparent);
+                QPainter p(canvas);
+                p.setFont(QApplication::font());
+                paint(style, kind, element, opt.data(), &p); // warm up caches
+                const unsigned long allocs0 = gs_allocations;
+                timer.start();
+                for (int i = 0; i < iterations; ++i)
+                    paint(style, kind, element, opt.data(), &p);
+                ns += timer.nsecsElapsed();
+                allocs += gs_allocations - allocs0;
+                ops += iterations;
+                p.end();
+            }
+        }
+    }
+    result.nsPerOp = double(ns)/ops;
+    result.allocsPerOp = double(allocs)/ops;
+    return result;
+}
+
+static QMap<QString, QJsonObject>
+readBaseline(const QString &path)
+{
+    QMap<QString, QJsonObject> baseline;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "cannot read baseline %s\n", qPrintable(path));
+        return baseline;
+    }
+    const QJsonArray elements = QJsonDocument::fromJson(file.readAll()).object().value("elements").toArray();
+    for (int i = 0; i < elements.count(); ++i) {
+        const QJsonObject o = elements.at(i).toObject();
+        baseline.insert(o.value("name").toString(), o);
+    }
+    return baseline;
+}
+
+int
+main(int argc, char **argv)
+{
+    if (qgetenv("QT_QPA_PLATFORM").isEmpty())
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+
+    QString styleName("virtuality"), output, baselinePath, filter;
+    int iterations = 50;
+    double tolerance = 10.0;
+    const QStringList args = app.arguments();
+    for (int i = 1; i < args.count(); ++i) {
+        const QString &arg = args.at(i);
+        const bool hasValue = i + 1 < args.count();
+        if (arg == "--style" && hasValue)
+            styleName = args.at(++i).toLower();
+        else if (arg == "--iterations" && hasValue)
+            iterations = qMax(1, args.at(++i).toInt());
+        else if (arg == "--output" && hasValue)
+            output = args.at(++i);
+        else if (arg == "--baseline" && hasValue)
+            baselinePath = args.at(++i);
+        else if (arg == "--tolerance" && hasValue)
+            tolerance = args.at(++i).toDouble();
+        else if (arg == "--filter" && hasValue)
+            filter = args.at(++i);
+        else {
+            fprintf(stderr, "usage: %s [--style name] [--iterations n] [--output file.json] "
+                            "[--baseline file.json] [--tolerance percent] [--filter substring]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    BE::Style *style = new BE::Style(styleName);
+    QApplication::setStyle(style);
+
+    const QPalette palettes[N_PALETTES] = { palette(style, 0), palette(style, 1) };
+    QImage canvas(sizes[N_SIZES-1] + QSize(8, 8), QImage::Format_ARGB32_Premultiplied);
+
+    QList<Result> results;
+    for (int kind = PE; kind <= CC; ++kind) {
+        for (int element = 0; element < 0x100; ++element) {
+            if (!BE::Style::hasRoutine(BE::Style::RoutineType(kind), element))
+                continue;
+            if (!filter.isEmpty() && !elementName(Kind(kind), element).contains(filter))
+                continue;
+            results << measure(style, Kind(kind), element, iterations, palettes, &canvas);
+        }
+    }
+
+    const QMap<QString, QJsonObject> baseline = baselinePath.isEmpty() ? QMap<QString, QJsonObject>() : readBaseline(baselinePath);
+    int regressions = 0;
+    QJsonArray elements;
+    printf("%-40s %12s %10s %10s\n", "element", "ns/op", "allocs/op", "delta");
+    foreach (const Result &r, results) {
+        QString delta;
+        QMap<QString, QJsonObject>::const_iterator base = baseline.constFind(r.name);
+        if (base != baseline.constEnd()) {
+            const double bNs = base->value("nsPerOp").toDouble();
+            const double bAllocs = base->value("allocsPerOp").toDouble();
+            const double change = bNs > 0.0 ? 100.0*(r.nsPerOp - bNs)/bNs : 0.0;
+            delta = QString::number(change, 'f', 1) + "%";
+            if (change > tolerance || r.allocsPerOp > bAllocs + 0.5) {
+                delta += " !";
+                ++regressions;
+            }
+        }
+        printf("%-40s %12.0f %10.1f %10s\n", qPrintable(r.name), r.nsPerOp, r.allocsPerOp, qPrintable(delta));
+
+        QJsonObject o;
+        o.insert("name", r.name);
+        o.insert("nsPerOp", r.nsPerOp);
+        o.insert("allocsPerOp", r.allocsPerOp);
+        elements.append(o);
+    }
+
+    if (!output.isEmpty()) {
+        QJsonObject root;
+        root.insert("style", styleName);
+        root.insert("iterations", iterations);
+        root.insert("samplesPerElement", N_STATES*N_SIZES*N_PALETTES);
+        root.insert("qt", QString::fromLatin1(qVersion()));
+        root.insert("elements", elements);
+        QFile file(output);
+        if (file.open(QIODevice::WriteOnly|QIODevice::Truncate))
+            file.write(QJsonDocument(root).toJson());
+        else
+            fprintf(stderr, "cannot write %s\n", qPrintable(output));
+    }
+
+    if (regressions)
+        fprintf(stderr, "%d element(s) regressed beyond %.1f%% or allocate more than the baseline\n", regressions, tolerance);
+
+    return regressions ? 1 : 0;
+}
@@ -24,6 +24,7 @@
 #include <QStyleOptionMenuItem>
 
 #include "draw.h"
+#include "pixcache.h"
 #include "animator/hover.h"
 
 #include <QtDebug>
@@ -32,6 +33,29 @@
 
 static struct AnimPair { const QWidget *widget; int step; } anim = {0,0};
 
+static void
+paintButtonFrame(QPainter *painter, const QRectF &r, const QColor &c, const QColor &c1, bool sunken, bool gradient)
+{
+    if (sunken) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(c);
+    } else if (gradient) {
+        QLinearGradient lg(r.x(), r.y(), r.x(), r.bottom());
+        lg.setColorAt(0.0, c1);
+        lg.setColorAt(0.25, c);
+        lg.setColorAt(0.75, c);
+        lg.setColorAt(1.0, c1);
+        painter->setPen(QPen(lg, FRAME_STROKE));
+        painter->setBrush(Qt::NoBrush);
+    } else {
+        painter->setPen(QPen(c, FRAME_STROKE));
+        painter->setBrush(Qt::NoBrush);
+    }
+    painter->setRenderHint(QPainter::Antialiasing);
+    const int radius = r.height()/2;
+    painter->drawRoundedRect(r, radius, radius);
+}
+
 static bool isCheckableButton(const QWidget *w, const QStyleOption *option)
 {
     const QAbstractButton *b = qobject_cast<const QAbstractButton*>(w);
@@ -143,9 +167,9 @@ Style::drawButtonFrame(const QStyleOption *option, QPainter *painter, const QWid
         if (widget && widget->testAttribute(Qt::WA_SetPalette)) { // button has custom palette - see which color differs
             const QColor globalBg = QApplication::palette().color(PAL.currentColorGroup(), QPalette::Button),
                          globalFg = QApplication::palette().color(PAL.currentColorGroup(), QPalette::ButtonText);
-            if (globalBg != FCOLOR(Button) && FX::haveContrast(FCOLOR(Button), FCOLOR(Window)))
+            if (globalBg != FCOLOR(Button) && DERIVED(buttonOnWindow))
                 oc = FCOLOR(Button);
-            else if (globalFg != FCOLOR(ButtonText) && FX::haveContrast(FCOLOR(ButtonText), FCOLOR(Window)))
+            else if (globalFg != FCOLOR(ButtonText) && DERIVED(buttonTextOnWindow))
                 oc = FCOLOR(ButtonText);
         }
         if (!isEnabled) {
@@ -173,8 +197,6 @@ Style::drawButtonFrame(const QStyleOption *option, QPainter *painter, const QWid
             r.setHeight(qMin(r.height(), r.width()));
         }
 
-        SAVE_PAINTER(Pen|Brush|Alias);
-
         QColor c(oc);
         if (sunken) {
             c = FCOLOR(Highlight);
@@ -185,29 +207,41 @@ Style::drawButtonFrame(const QStyleOption *option, QPainter *painter, const QWid
         }
 
         r.moveCenter(FLOAT_CENTER(RECT));
-        if (sunken) {
-            painter->setPen(Qt::NoPen);
-            painter->setBrush(c);
-            if (int(Style::halfStroke) != Style::halfStroke)
-                r.adjust(0.5f, 0.5f, -0.5f, -0.5f);
+        if (sunken && int(Style::halfStroke) != Style::halfStroke)
+            r.adjust(0.5f, 0.5f, -0.5f, -0.5f);
+        const bool gradient = !(squareButton || sunken || hasFocus || anim.step);
+        const QColor c1 = gradient ? FX::blend(FCOLOR(Window), oc, MAX_STEPS, 1 + MAX_STEPS/2) : c;
+
+        if (PixCache::accepts(painter, RECT.size())) {
+            // the frame only depends on the things below, so hovering a dialog full of buttons
+            // no longer rasterizes the same rounded rects over and over again
+            struct {
+                int w, h, step, stroke;
+                bool sunken, focus, enabled;
+                QRgb c, c1;
+                qreal dpr;
+            } k;
+            memset(&k, 0, sizeof(k));
+            k.w = RECT.width(); k.h = RECT.height(); k.step = anim.step; k.stroke = FRAME_STROKE_WIDTH;
+            k.sunken = sunken; k.focus = hasFocus; k.enabled = isEnabled;
+            k.c = c.rgba(); k.c1 = c1.rgba(); k.dpr = PixCache::dpr(painter);
+            const QByteArray key = PixCache::key('b', k);
+            QPixmap frame;
+            if (!PixCache::find(key, &frame)) {
+                frame = PixCache::pixmap(RECT.size(), k.dpr);
+                QPainter p(&frame);
+                p.translate(-RECT.topLeft());
+                paintButtonFrame(&p, r, c, c1, sunken, gradient);
+                p.end();
+                PixCache::insert(key, frame);
+            }
+            painter->drawPixmap(RECT.topLeft(), frame);
         } else {
-            painter->setPen(QPen(c, FRAME_STROKE));
-            painter->setBrush(Qt::NoBrush);
-        }
-        painter->setRenderHint(QPainter::Antialiasing);
-        const int radius = r.height()/2;
-
-        if (!(squareButton || sunken || hasFocus || anim.step)) {
-            QLinearGradient lg(r.x(), r.y(), r.x(), r.bottom());
-            const QColor c1(FX::blend(FCOLOR(Window), oc, MAX_STEPS, 1 + MAX_STEPS/2));
-            lg.setColorAt(0.0, c1);
-            lg.setColorAt(0.25, c);
-            lg.setColorAt(0.75, c);
-            lg.setColorAt(1.0, c1);
-            painter->setPen(QPen(lg, FRAME_STROKE));
+            SAVE_PAINTER(Pen|Brush|Alias);
+            paintButtonFrame(painter, r, c, c1, sunken, gradient);
+            RESTORE_PAINTER
         }
 
-        painter->drawRoundedRect(r, radius, radius);
 #if false // rails
         if (!(sunken || hasFocus) && anim.step < MAX_STEPS) {
             const int x = RECT.x() + RECT.width() / 2;
@@ -228,7 +262,6 @@ Style::drawButtonFrame(const QStyleOption *option, QPainter *painter, const QWid
             painter->drawRoundedRect(r, radius, radius);
         }
 #endif
-        RESTORE_PAINTER
     }
 
     if ( resetAnim )
@@ -291,6 +324,39 @@ Style::drawPushButtonLabel(const QStyleOption *option, QPainter *painter, const
 
 #define DRAW_SEGMENT(_R_, _START_, _SPAN_) (hasFocus || qAbs(_SPAN_) > 5759) ? painter->drawEllipse(_R_) : painter->drawArc(_R_, _START_, _SPAN_)
 
+static void
+paintRadioOrCheckBox(QPainter *painter, QRectF r, const QPen &pen, const QBrush &brush, const QColor &drop,
+                     bool isRadio, bool rtl, bool hasFocus, int a, char state)
+{
+    painter->setRenderHint(QPainter::Antialiasing, true);
+    painter->setPen(pen);
+    painter->setBrush(brush);
+    if (isRadio) {
+        if (rtl)
+            DRAW_SEGMENT(r, 16*(84-a), 16*(192+2*a));
+        else
+            DRAW_SEGMENT(r, -16*(96+a), 16*(192+2*a));
+    } else
+        DRAW_SEGMENT(r, 16*(6+a), -16*(192+2*a));
+
+    if (state) { // the drop
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(drop);
+        const int d = intMin(F(4), r.height()/3);
+        r.adjust(d, d, -d, -d);
+        if (state == 1) // tri-state
+            painter->drawChord(r, -180*16, 180*16);
+        else
+            painter->drawEllipse(r);
+    }
+}
+
+typedef struct {
+    int w, h, fx, fy, stroke, a;
+    QRgb pen, brush, drop;
+    qreal dpr;
+} CheckBoxAtlasKey;
+
 void
 Style::drawRadioOrCheckBox(const QStyleOption *option, QPainter *painter, const QWidget *widget, bool isRadio) const
 {
@@ -307,51 +373,59 @@ Style::drawRadioOrCheckBox(const QStyleOption *option, QPainter *painter, const
 
     const int s = (qMin(RECT.width(), RECT.height()) & ~1);
     STROKED_RECT(r, QRect(RECT.topLeft(), QSize(s-FRAME_STROKE_WIDTH, s-FRAME_STROKE_WIDTH)));
-    if (option->direction == Qt::RightToLeft)
+    const bool rtl = option->direction == Qt::RightToLeft;
+    if (rtl)
         r.moveRight(RECT.right() + halfStroke);
 
-    SAVE_PAINTER(Pen|Brush|Alias);
-
-    painter->setRenderHint(QPainter::Antialiasing, true);
-
     int animStep = (isRadio && state) || option->state & QStyle::State_Item ? 0 : HOVER_STEP;
     const int a = animStep*168/(2*MAX_STEPS);
+    QPen pen(Qt::NoPen);
+    QBrush brush(Qt::NoBrush);
     if (isEnabled && (option->state & State_Selected)) { // popup menu
-        painter->setPen(QPen(FCOLOR(Highlight), FRAME_STROKE));
-        painter->setBrush(Qt::NoBrush);
+        pen = QPen(FCOLOR(Highlight), FRAME_STROKE);
     } else if (sunken) {
-        painter->setPen(Qt::NoPen);
-        painter->setBrush(FCOLOR(Highlight));
+        brush = FCOLOR(Highlight);
     } else {
-        const QColor c(FX::blend(FCOLOR(Window), FCOLOR(WindowText)));
-        painter->setPen(QPen(hasFocus ? FX::blend(FCOLOR(Highlight), c, MAX_STEPS-animStep, animStep) : c, FRAME_STROKE));
-        painter->setBrush(Qt::NoBrush);
+        const QColor c(DERIVED(windowMid));
+        pen = QPen(hasFocus ? FX::blend(FCOLOR(Highlight), c, MAX_STEPS-animStep, animStep) : c, FRAME_STROKE);
+    }
+    QColor drop;
+    if (sunken)
+        drop = FCOLOR(HighlightedText);
+    else if (hasFocus)
+        drop = FX::blend(FCOLOR(WindowText), FCOLOR(Highlight), MAX_STEPS - animStep, animStep);
+    else
+        drop = FCOLOR(WindowText);
+
+    // one atlas per size, colors and hover step - menus and item views repeat these a lot
+    QRectF local;
+    const QRect cell = PixCache::gridCell(r, halfStroke + 1, &local);
+    PixCache::Atlas *atlas = 0;
+    if (PixCache::accepts(painter, cell.size())) {
+        CheckBoxAtlasKey k; memset(&k, 0, sizeof(k));
+        k.w = cell.width(); k.h = cell.height(); k.stroke = FRAME_STROKE_WIDTH; k.a = a;
+        k.fx = qRound(16*local.x()); k.fy = qRound(16*local.y());
+        k.pen = pen.style() == Qt::NoPen ? 0 : pen.color().rgba();
+        k.brush = brush.style() == Qt::NoBrush ? 0 : brush.color().rgba();
+        k.drop = drop.rgba(); k.dpr = PixCache::dpr(painter);
+        atlas = PixCache::atlas(PixCache::key('r', k), cell.size(), 24, k.dpr);
+    }
+    if (!atlas) {
+        SAVE_PAINTER(Pen|Brush|Alias);
+        paintRadioOrCheckBox(painter, r, pen, brush, drop, isRadio, rtl, hasFocus, a, state);
+        RESTORE_PAINTER
+        return;
     }
-    if (isRadio) {
-        if (option->direction == Qt::LeftToRight)
-            DRAW_SEGMENT(r, -16*(96+a), 16*(192+2*a));
-        else
-            DRAW_SEGMENT(r, 16*(84-a), 16*(192+2*a));
-    } else
-        DRAW_SEGMENT(r, 16*(6+a), -16*(192+2*a));
 
-    if (state) { // the drop
-        painter->setPen(Qt::NoPen);
-        const int d = intMin(F(4), r.height()/3);
-        r.adjust(d, d, -d, -d);
-        if (sunken) {
-            painter->setBrush(FCOLOR(HighlightedText));
-        } else if (hasFocus) {
-            painter->setBrush(FX::blend(FCOLOR(WindowText), FCOLOR(Highlight), MAX_STEPS - animStep, animStep));
-        } else {
-            painter->setBrush(FCOLOR(WindowText));
-        }
-        if (state == 1) // tri-state
-            painter->drawChord(r, -180*16, 180*16);
-        else
-            painter->drawEllipse(r);
+    const int index = ((int(state)*2 + rtl)*2 + isRadio)*2 + hasFocus;
+    if (PixCache::claimCell(atlas, index)) {
+        QPainter p(&atlas->sprite);
+        const QRect cr = PixCache::cellRect(atlas, index);
+        p.setClipRect(cr);
+        p.translate(cr.topLeft());
+        paintRadioOrCheckBox(&p, local, pen, brush, drop, isRadio, rtl, hasFocus, a, state);
     }
-    RESTORE_PAINTER
+    PixCache::drawCell(painter, cell.topLeft(), atlas, index);
 }
 
 void
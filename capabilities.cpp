@@ -0,0 +1,198 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QCoreApplication>
+#if QT_VERSION >= 0x050000
+#include <QAbstractNativeEventFilter>
+#endif
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "capabilities.h"
+
+#ifdef BE_WS_X11
+#include "xproperty.h"
+#include <X11/Xatom.h>
+#if QT_VERSION >= 0x050000
+#include <xcb/xcb.h>
+#include <xcb/xfixes.h>
+#endif
+#include "fixx11h.h"
+#endif
+
+using namespace BE;
+
+#if defined(BE_WS_X11) && QT_VERSION >= 0x050000
+namespace BE {
+class CapabilityFilter : public QAbstractNativeEventFilter
+{
+public:
+    CapabilityFilter(Capabilities *caps) : m_caps(caps) {}
+#if QT_VERSION >= 0x060000
+    bool nativeEventFilter(const QByteArray &eventType, void *message, qintptr *)
+#else
+    bool nativeEventFilter(const QByteArray &eventType, void *message, long *)
+#endif
+    {
+        if (eventType != "xcb_generic_event_t")
+            return false;
+        xcb_generic_event_t *ev = static_cast<xcb_generic_event_t*>(message);
+        const int type = ev->response_type & ~0x80;
+        if (m_caps->m_xfixesEvent && type == m_caps->m_xfixesEvent + XCB_XFIXES_SELECTION_NOTIFY) {
+            xcb_xfixes_selection_notify_event_t *sev = reinterpret_cast<xcb_xfixes_selection_notify_event_t*>(ev);
+            if (sev->selection == m_caps->m_cmSelection)
+                m_caps->setCompositing(sev->owner != XCB_NONE);
+        } else if (type == XCB_PROPERTY_NOTIFY) {
+            xcb_property_notify_event_t *pev = reinterpret_cast<xcb_property_notify_event_t*>(ev);
+            if (pev->atom == XProperty::netSupported && pev->window == BE_X11_ROOT) // not from inside the filter
+                QMetaObject::invokeMethod(m_caps, "readSupported", Qt::QueuedConnection);
+        }
+        return false;
+    }
+private:
+    Capabilities *m_caps;
+};
+}
+static BE::CapabilityFilter *gs_filter = 0;
+#endif
+
+Capabilities *Capabilities::s_instance = 0;
+
+Capabilities *
+Capabilities::instance()
+{
+    if (!s_instance)
+        s_instance = new Capabilities;
+    return s_instance;
+}
+
+Capabilities::Capabilities() : QObject(QCoreApplication::instance())
+, m_compositing(true), m_shadows(false), m_blur(false), m_cmSelection(0), m_xfixesEvent(0)
+{
+#ifdef BE_WS_X11
+    if (!BE::isPlatformX11())
+        return; // we assume wayland - or any other compositing capable display server
+    XProperty::init();
+    char name[32];
+    sprintf(name, "_NET_WM_CM_S%d", DefaultScreen(BE_X11_DISPLAY));
+#if QT_VERSION >= 0x050000
+    xcb_connection_t *c = BE_XCB_CONN;
+    const xcb_window_t root = BE_X11_ROOT;
+    // send everything first, then collect
+    xcb_intern_atom_cookie_t atomCookie = xcb_intern_atom(c, false, strlen(name), name);
+    xcb_get_window_attributes_cookie_t attrCookie = xcb_get_window_attributes(c, root);
+    const xcb_query_extension_reply_t *xfixes = xcb_get_extension_data(c, &xcb_xfixes_id);
+    const bool haveXFixes = xfixes && xfixes->present;
+    xcb_xfixes_query_version_cookie_t versionCookie;
+    if (haveXFixes)
+        versionCookie = xcb_xfixes_query_version(c, XCB_XFIXES_MAJOR_VERSION, XCB_XFIXES_MINOR_VERSION);
+
+    if (xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c, atomCookie, NULL)) {
+        m_cmSelection = reply->atom;
+        free(reply);
+    }
+    // Qt selects property changes on the root window anyway, but the mask is per client - don't step on it
+    if (xcb_get_window_attributes_reply_t *reply = xcb_get_window_attributes_reply(c, attrCookie, NULL)) {
+        if (!(reply->your_event_mask & XCB_EVENT_MASK_PROPERTY_CHANGE)) {
+            const uint32_t mask = reply->your_event_mask | XCB_EVENT_MASK_PROPERTY_CHANGE;
+            xcb_change_window_attributes(c, root, XCB_CW_EVENT_MASK, &mask);
+        }
+        free(reply);
+    }
+    if (haveXFixes) {
+        free(xcb_xfixes_query_version_reply(c, versionCookie, NULL));
+        m_xfixesEvent = xfixes->first_event;
+        xcb_xfixes_select_selection_input(c, root, m_cmSelection,
+                                          XCB_XFIXES_SELECTION_EVENT_MASK_SET_SELECTION_OWNER |
+                                          XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_WINDOW_DESTROY |
+                                          XCB_XFIXES_SELECTION_EVENT_MASK_SELECTION_CLIENT_CLOSE);
+    }
+    xcb_get_selection_owner_cookie_t ownerCookie = xcb_get_selection_owner(c, m_cmSelection);
+    if (xcb_get_selection_owner_reply_t *reply = xcb_get_selection_owner_reply(c, ownerCookie, NULL)) {
+        m_compositing = reply->owner != XCB_NONE;
+        free(reply);
+    }
+    if (!gs_filter)
+        gs_filter = new CapabilityFilter(this);
+    QCoreApplication::instance()->installNativeEventFilter(gs_filter);
+#else
+    m_cmSelection = XInternAtom(BE_X11_DISPLAY, name, False);
+#endif
+    readSupported();
+#endif
+}
+
+Capabilities::~Capabilities()
+{
+#if defined(BE_WS_X11) && QT_VERSION >= 0x050000
+    if (gs_filter) {
+        if (QCoreApplication::instance())
+            QCoreApplication::instance()->removeNativeEventFilter(gs_filter);
+        delete gs_filter;
+        gs_filter = 0;
+    }
+#endif
+    s_instance = 0;
+}
+
+bool
+Capabilities::compositing()
+{
+#if defined(BE_WS_X11) && QT_VERSION < 0x050000
+    return XGetSelectionOwner(BE_X11_DISPLAY, instance()->m_cmSelection) != None;
+#else
+    return instance()->m_compositing;
+#endif
+}
+
+void
+Capabilities::setCompositing(bool on)
+{
+    if (on == m_compositing)
+        return;
+    m_compositing = on;
+    emit compositingChanged(on);
+}
+
+void
+Capabilities::readSupported()
+{
+#ifdef BE_WS_X11
+    unsigned long n = 0;
+    Atom *supported = XProperty::get<Atom>(BE_X11_ROOT, XProperty::netSupported, XProperty::ATOM, &n);
+    bool shadows = false, blur = false;
+    for (uint i = 0; supported && i < n; ++i) {
+        if (supported[i] == XProperty::kwinShadow)
+            shadows = true;
+        else if (supported[i] == XProperty::blurRegion)
+            blur = true;
+    }
+    if (supported)
+        XFree(supported);
+    if (shadows != m_shadows) {
+        m_shadows = shadows;
+        emit shadowsChanged(shadows);
+    }
+    if (blur != m_blur) {
+        m_blur = blur;
+        emit blurChanged(blur);
+    }
+#endif
+}
+
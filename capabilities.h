@@ -0,0 +1,61 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BE_CAPABILITIES_H
+#define BE_CAPABILITIES_H
+
+#include <QObject>
+
+namespace BE {
+
+/**
+ * What the window system can do for us, so nobody has to ask the server while painting.
+ * Compositing follows the owner of the _NET_WM_CM_Sn selection (XFixes), shadow and blur
+ * support the _NET_SUPPORTED property of the root window. Anything but X11 is assumed to
+ * composite and to support neither.
+ * Qt4 has no native event filter, so compositing is asked for on every call there and the
+ * rest is read once.
+ */
+class Capabilities : public QObject
+{
+    Q_OBJECT
+public:
+    static Capabilities *instance();
+    static bool compositing();
+    static inline bool shadows() { return instance()->m_shadows; }
+    static inline bool blur() { return instance()->m_blur; }
+signals:
+    void compositingChanged(bool);
+    void shadowsChanged(bool);
+    void blurChanged(bool);
+private slots:
+    void readSupported();
+private:
+    friend class CapabilityFilter;
+    Capabilities();
+    ~Capabilities();
+    void setCompositing(bool on);
+    static Capabilities *s_instance;
+    bool m_compositing, m_shadows, m_blur;
+    unsigned long m_cmSelection;
+    int m_xfixesEvent;
+};
+
+}
+
+#endif // BE_CAPABILITIES_H
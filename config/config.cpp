@@ -36,6 +36,7 @@
 
 #include "kdeini.h"
 #include "../config.defaults"
+#include "../snapshot.h"
 #include "config.h"
 
 typedef QMap<QString,QString> StringMap;
@@ -471,6 +472,8 @@ Config::save()
 {
     if ( !BConfig::save() )
         return false;
+    /** spare the applications to parse the settings */
+    BE::Snapshot::compile();
 
     /** save the palette loaded from store to qt configuration */
     if (!loadedPal)
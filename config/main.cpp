@@ -17,6 +17,7 @@
  */
 
 #include "config.h"
+#include "../snapshot.h"
 #include "ui_uiDemo.h"
 #include "dialog.h"
 #include <QDir>
@@ -259,6 +260,10 @@ main(int argc, char *argv[])
             if (deco) // update kwin
                 QProcess::startDetached("qdbus", QStringList() << "org.kde.kwin" << "/KWin" << "reconfigure" );
         }
+        if (!deco && (mode == WriteSetting || mode == DeleteSetting)) {
+            config.sync();
+            BE::Snapshot::compile();
+        }
         return 0;
     }
     case Revision: {
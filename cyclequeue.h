@@ -0,0 +1,153 @@
+/*
+ *   Bespin library for Qt style, KWin decoration and everythng else
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This library is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU Library General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU Library General Public License for more details
+ *
+ *   You should have received a copy of the GNU Library General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BE_CYCLEQUEUE_H
+#define BE_CYCLEQUEUE_H
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QHash>
+#include <QPointer>
+#include <QTimerEvent>
+#include <QWidget>
+
+namespace BE {
+
+/**
+ * process() runs once with the next event loop cycle after schedule(), no matter how often
+ * that was called. The event has low priority, ie. whatever is pending goes first.
+ * With an interval (ms), process() runs at most that often - unless schedule() is urgent.
+ */
+class CycleQueue : public QObject
+{
+public:
+    CycleQueue(int interval = 0) : QObject(), m_scheduled(false), m_interval(interval), m_timer(0) {}
+    void schedule(bool urgent = false)
+    {
+        if (m_timer && urgent) {
+            killTimer(m_timer);
+            m_timer = 0;
+            m_scheduled = false;
+        }
+        if (m_scheduled)
+            return;
+        m_scheduled = true;
+        const qint64 wait = (m_interval && !urgent && m_last.isValid()) ? m_interval - m_last.elapsed() : 0;
+        if (wait > 0)
+            m_timer = startTimer(int(wait));
+        else
+            QCoreApplication::postEvent(this, new QEvent(QEvent::User), Qt::LowEventPriority);
+    }
+protected:
+    virtual void process() = 0;
+    void customEvent(QEvent *e)
+    {
+        if (e->type() == QEvent::User && m_scheduled && !m_timer)
+            run();
+    }
+    void timerEvent(QTimerEvent *e)
+    {
+        if (e->timerId() != m_timer)
+            return;
+        killTimer(m_timer);
+        m_timer = 0;
+        run();
+    }
+private:
+    void run()
+    {
+        m_scheduled = false;
+        if (m_interval)
+            m_last.start();
+        process();
+    }
+    bool m_scheduled;
+    int m_interval, m_timer;
+    QElapsedTimer m_last;
+};
+
+/**
+ * Per window values for the window system (X11 properties and alike), exported with the next
+ * cycle - the last request wins and nothing is exported if the window already got that value.
+ * A new native window lacks whatever the old one had, so it's exported again then.
+ * With an interval, a windows first value still goes out with the next cycle.
+ * T needs operator==, exportValue() does the actual writing.
+ */
+template <typename T>
+class WindowExport : public CycleQueue
+{
+public:
+    WindowExport(int interval = 0) : CycleQueue(interval) {}
+    void request(QWidget *window, const T &value)
+    {
+        Pending &p = m_pending[window];
+        p.window = window;
+        p.value = value;
+        schedule(!m_exported.contains(window));
+    }
+    // the window lost the value by other means
+    void forget(QWidget *window)
+    {
+        m_pending.remove(window);
+        if (m_exported.remove(window))
+            window->removeEventFilter(this);
+    }
+protected:
+    virtual void exportValue(QWidget *window, const T &value) = 0;
+    bool eventFilter(QObject *o, QEvent *e)
+    {
+        if (e->type() == QEvent::Destroy || e->type() == QEvent::WinIdChange)
+            m_exported.remove(static_cast<QWidget*>(o));
+        return false;
+    }
+    void process()
+    {
+        // exportValue() might request more, that's for the next cycle
+        const QHash<const QWidget*, Pending> pending = m_pending;
+        m_pending.clear();
+        for (typename QHash<const QWidget*, Pending>::const_iterator it = pending.constBegin(),
+                                                                     end = pending.constEnd(); it != end; ++it) {
+            QWidget *window = it.value().window;
+            if (!(window && window->testAttribute(Qt::WA_WState_Created) && window->internalWinId()))
+                continue;
+            typename QHash<const QWidget*, T>::iterator last = m_exported.find(window);
+            if (last != m_exported.end() && *last == it.value().value)
+                continue;
+            if (last == m_exported.end()) {
+                window->removeEventFilter(this);
+                window->installEventFilter(this);
+                m_exported.insert(window, it.value().value);
+            } else {
+                *last = it.value().value;
+            }
+            exportValue(window, it.value().value);
+        }
+    }
+private:
+    typedef struct {
+        QPointer<QWidget> window;
+        T value;
+    } Pending;
+    QHash<const QWidget*, Pending> m_pending;
+    QHash<const QWidget*, T> m_exported;
+};
+
+}
+
+#endif // BE_CYCLEQUEUE_H
@@ -0,0 +1,185 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "diskcache.h"
+
+using namespace BE;
+
+// bump when the file layout changes
+#define VERSION 1
+// the whole cache, the least recently used files go beyond that
+#define MAX_SIZE (32*1024*1024)
+
+typedef struct {
+    char magic[4];
+    quint32 version, width, height, bytesPerLine, format;
+    double dpr;
+} ImageHeader;
+
+typedef struct {
+    char magic[4];
+    quint32 version, size;
+} DataHeader;
+
+static QString
+cacheDir()
+{
+    static QString dir;
+    if (dir.isNull()) {
+        QByteArray xdg = qgetenv("XDG_CACHE_HOME");
+        dir = (xdg.isEmpty() ? QDir::homePath() + "/.cache" : QFile::decodeName(xdg)) + "/virtuality/";
+        QDir().mkpath(dir);
+    }
+    return dir;
+}
+
+static bool
+lessRecentlyUsed(const QFileInfo &f1, const QFileInfo &f2)
+{
+    return qMax(f1.lastRead(), f1.lastModified()) < qMax(f2.lastRead(), f2.lastModified());
+}
+
+// drops the least recently used files until the cache is down to 3/4 of MAX_SIZE
+static void
+prune()
+{
+    QFileInfoList files = QDir(cacheDir()).entryInfoList(QDir::Files | QDir::Hidden);
+    qint64 size = 0;
+    for (int i = 0; i < files.count(); ++i)
+        size += files.at(i).size();
+    if (size <= MAX_SIZE)
+        return;
+    std::sort(files.begin(), files.end(), lessRecentlyUsed);
+    for (int i = 0; i < files.count() && size > 3*MAX_SIZE/4; ++i) {
+        if (QFile::remove(files.at(i).absoluteFilePath()))
+            size -= files.at(i).size();
+    }
+}
+
+static void
+writeFile(const QByteArray &key, const char *header, qint64 headerSize, const char *data, qint64 size)
+{
+    // other processes may just be reading it, so write aside and move over
+    const QString path = cacheDir() + QFile::decodeName(key);
+    QFile file(path + '.' + QString::number(qint64(QCoreApplication::applicationPid())));
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    const bool ok = file.write(header, headerSize) == headerSize && file.write(data, size) == size;
+    file.close();
+    if (!ok || ::rename(QFile::encodeName(file.fileName()).constData(), QFile::encodeName(path).constData()))
+        file.remove();
+    else
+        prune();
+}
+
+bool
+DiskCache::loadImage(const QByteArray &key, QImage *image)
+{
+    QFile file(cacheDir() + QFile::decodeName(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    ImageHeader header;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(ImageHeader)) != qint64(sizeof(ImageHeader)))
+        return false;
+    const bool valid = !memcmp(header.magic, "BEIM", 4) && header.version == VERSION &&
+                       header.format == quint32(QImage::Format_ARGB32_Premultiplied) &&
+                       header.bytesPerLine >= 4*header.width &&
+                       file.size() == qint64(sizeof(ImageHeader)) + qint64(header.bytesPerLine)*header.height;
+    if (!valid)
+        return false;
+    // straight into the image, the data ends up in a pixmap anyway - there's nothing to share
+    QImage img(header.width, header.height, QImage::Format_ARGB32_Premultiplied);
+    if (img.isNull())
+        return false;
+    const qint64 bpl = qMin<qint64>(header.bytesPerLine, img.bytesPerLine());
+    if (qint64(header.bytesPerLine) == qint64(img.bytesPerLine())) {
+        const qint64 size = qint64(header.bytesPerLine)*header.height;
+        if (file.read(reinterpret_cast<char*>(img.bits()), size) != size)
+            return false;
+    } else for (uint y = 0; y < header.height; ++y) {
+        if (!file.seek(sizeof(ImageHeader) + qint64(header.bytesPerLine)*y) ||
+            file.read(reinterpret_cast<char*>(img.scanLine(y)), bpl) != bpl)
+            return false;
+    }
+#if QT_VERSION >= 0x050000
+    img.setDevicePixelRatio(header.dpr);
+#endif
+    *image = img;
+    return true;
+}
+
+void
+DiskCache::storeImage(const QByteArray &key, const QImage &image)
+{
+    const QImage img = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    if (img.isNull())
+        return;
+    ImageHeader header;
+    memset(&header, 0, sizeof(ImageHeader));
+    memcpy(header.magic, "BEIM", 4);
+    header.version = VERSION;
+    header.width = img.width();
+    header.height = img.height();
+    header.bytesPerLine = img.bytesPerLine();
+    header.format = QImage::Format_ARGB32_Premultiplied;
+#if QT_VERSION >= 0x050000
+    header.dpr = img.devicePixelRatio();
+#else
+    header.dpr = 1.0;
+#endif
+
+    writeFile(key, reinterpret_cast<const char*>(&header), sizeof(ImageHeader),
+                   reinterpret_cast<const char*>(img.constBits()), qint64(img.bytesPerLine())*img.height());
+}
+
+bool
+DiskCache::loadData(const QByteArray &key, QByteArray *data)
+{
+    QFile file(cacheDir() + QFile::decodeName(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    DataHeader header;
+    if (file.read(reinterpret_cast<char*>(&header), sizeof(DataHeader)) != qint64(sizeof(DataHeader)))
+        return false;
+    if (memcmp(header.magic, "BEDT", 4) || header.version != VERSION ||
+        file.size() != qint64(sizeof(DataHeader)) + header.size)
+        return false;
+    data->resize(header.size);
+    return file.read(data->data(), header.size) == qint64(header.size);
+}
+
+void
+DiskCache::storeData(const QByteArray &key, const QByteArray &data)
+{
+    DataHeader header;
+    memset(&header, 0, sizeof(DataHeader));
+    memcpy(header.magic, "BEDT", 4);
+    header.version = VERSION;
+    header.size = data.size();
+    writeFile(key, reinterpret_cast<const char*>(&header), sizeof(DataHeader), data.constData(), data.size());
+}
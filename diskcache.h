@@ -0,0 +1,44 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BE_DISKCACHE_H
+#define BE_DISKCACHE_H
+
+#include <QByteArray>
+
+class QImage;
+
+namespace BE {
+namespace DiskCache {
+
+/**
+ * Prerendered data that is expensive to create and the same for every process, kept in
+ * $XDG_CACHE_HOME/virtuality - the key is the file name, so it has to tell everything the data
+ * depends on. Files carry a small header, broken, foreign or outdated ones are simply ignored
+ * (and replaced with the next store). Stores keep the whole cache below 32MiB by dropping the
+ * least recently used files.
+ */
+bool loadImage(const QByteArray &key, QImage *image);
+void storeImage(const QByteArray &key, const QImage &image);
+bool loadData(const QByteArray &key, QByteArray *data);
+void storeData(const QByteArray &key, const QByteArray &data);
+
+}
+}
+
+#endif // BE_DISKCACHE_H
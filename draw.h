@@ -44,12 +44,13 @@ namespace Corner {
 
 #define STROKED_RECT(_RF_, _R_) QRectF _RF_(_R_); _RF_.adjust(Style::halfStroke, Style::halfStroke, -Style::halfStroke, -Style::halfStroke)
 #define FRAME_STROKE FRAME_STROKE_WIDTH, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin
-#define FRAME_COLOR FX::blend(FCOLOR(Window), FCOLOR(WindowText), 8, 1)
-#define FOCUS_FRAME_PEN QPen(FX::blend(FCOLOR(Window), FCOLOR(Highlight), 1, 2), FRAME_STROKE)
+#define DERIVED(_C_) Style::derivedColors(PAL)._C_
+#define FRAME_COLOR DERIVED(frame)
+#define FOCUS_FRAME_PEN QPen(DERIVED(focusFrame), FRAME_STROKE)
 #define FRAME_PEN QPen(FRAME_COLOR, FRAME_STROKE)
 
-#define THERMOMETER_COLOR FX::blend(FCOLOR(Window), FCOLOR(WindowText), 1, 4)
-#define GROOVE_COLOR FX::blend(FCOLOR(Window), FCOLOR(WindowText), 8, 1)
+#define THERMOMETER_COLOR DERIVED(thermometer)
+#define GROOVE_COLOR DERIVED(frame)
 
 #define intMax(_F1_, _F2_) qMax(int(_F1_), int(_F2_))
 #define intMin(_F1_, _F2_) qMin(int(_F1_), int(_F2_))
@@ -20,6 +20,7 @@
 #include <QListView>
 #include <QFormLayout>
 #include <QPainterPath>
+#include <qmath.h>
 #include <QTableView>
 #include <QTreeView>
 #include <QTextEdit>
@@ -27,16 +28,24 @@
 #include <QStyleOptionFrame>
 
 #include "draw.h"
+#include "pixcache.h"
 
 #include "debug.h"
 
 #include <QtDebug>
 
-QPainterPath framePath(const QRect &rect, char corners, int rnd, bool hasFocus = false)
+static void
+frameBracket(const QRect &rect, bool hasFocus, int *dx, int *dy)
+{
+    STROKED_RECT(r, rect);
+    *dx = hasFocus ? intMin(intMax(r.width()/4, F(32)), r.width()/2) : intMin(r.width()/4,F(32));
+    *dy = hasFocus ? intMin(intMax(r.height()/4, F(32)), r.height()/2) : intMin(r.height()/4,F(32));
+}
+
+static QPainterPath
+framePath(const QRect &rect, char corners, int rnd, int dx, int dy)
 {
     STROKED_RECT(r, rect);
-    const int dx = hasFocus ? intMin(intMax(r.width()/4, F(32)), r.width()/2) : intMin(r.width()/4,F(32));
-    const int dy = hasFocus ? intMin(intMax(r.height()/4, F(32)), r.height()/2) : intMin(r.height()/4,F(32));
     const int rnd_2 = 2*rnd;
 
     QPainterPath path;
@@ -96,6 +105,57 @@ QPainterPath framePath(const QRect &rect, char corners, int rnd, bool hasFocus =
     return path;
 }
 
+/**
+ * Paints the corner brackets with the current pen.
+ * Brackets only depend on their length, so they're prerendered once and blitted. Only the focused
+ * and small frames get other lengths
+ */
+static void
+drawFramePath(QPainter *painter, const QRect &rect, char corners, int rnd, bool hasFocus = false)
+{
+    int dx, dy;
+    frameBracket(rect, hasFocus, &dx, &dy);
+    const int stroke = qCeil(painter->pen().widthF());
+    const int ex = qMax(dx, rnd) + stroke + 1, ey = qMax(dy, rnd) + stroke + 1;
+    const QSize size(2*ex + 1, 2*ey + 1);
+    if (rect.width() < size.width() || rect.height() < size.height() || !PixCache::accepts(painter, size)) {
+        painter->drawPath(framePath(rect, corners, rnd, dx, dy));
+        return;
+    }
+
+    struct {
+        int dx, dy, rnd, corners;
+        float stroke;
+        QRgb color;
+        qreal dpr;
+    } k;
+    memset(&k, 0, sizeof(k));
+    k.dx = dx; k.dy = dy; k.rnd = rnd; k.corners = corners;
+    k.stroke = painter->pen().widthF(); k.color = painter->pen().color().rgba(); k.dpr = PixCache::dpr(painter);
+    const QByteArray key = PixCache::key('f', k);
+    QPixmap sprite;
+    if (!PixCache::find(key, &sprite)) {
+        sprite = PixCache::pixmap(size, k.dpr);
+        QPainter p(&sprite);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(painter->pen());
+        p.setBrush(Qt::NoBrush);
+        p.drawPath(framePath(QRect(QPoint(0,0), size), corners, rnd, dx, dy));
+        p.end();
+        PixCache::insert(key, sprite);
+    }
+    int pieces = 0;
+    if (corners & Corner::TopLeft)
+        pieces |= PixCache::TopLeft;
+    if (corners & Corner::TopRight)
+        pieces |= PixCache::TopRight;
+    if (corners & Corner::BottomLeft)
+        pieces |= PixCache::BottomLeft;
+    if (corners & Corner::BottomRight)
+        pieces |= PixCache::BottomRight;
+    PixCache::drawNineSlice(painter, rect, sprite, QMargins(ex, ey, ex, ey), pieces);
+}
+
 
 void
 Style::drawFocusFrame(const QStyleOption *option, QPainter *painter, const QWidget *w) const
@@ -209,7 +269,7 @@ Style::drawFrame(const QStyleOption *option, QPainter *painter, const QWidget *w
     if (!view || view->isHeaderHidden()) {
         corners |= (option->direction == Qt::LeftToRight ? Corner::TopLeft : Corner::TopRight);
     }
-    painter->drawPath(framePath(RECT, corners, config.frame.roundness, hasFocus));
+    drawFramePath(painter, RECT, corners, config.frame.roundness, hasFocus);
     RESTORE_PAINTER
 }
 
@@ -283,6 +343,6 @@ Style::drawGroupBoxFrame(const QStyleOption *option, QPainter *painter, const QW
 
     const char corners = option->direction == Qt::LeftToRight ? Corner::TopRight|Corner::BottomLeft :
                                                                 Corner::TopLeft|Corner::BottomRight;
-    painter->drawPath(framePath(RECT, corners, config.frame.roundness));
+    drawFramePath(painter, RECT, corners, config.frame.roundness);
     RESTORE_PAINTER
 }
@@ -17,10 +17,44 @@
  */
 
 #include "draw.h"
+#include "pixcache.h"
 
 
 #define DRAW_SEGMENT(_R_, _START_, _SPAN_) sunken ? painter->drawEllipse(_R_) : painter->drawArc(_R_, _START_, _SPAN_)
 
+static void
+paintCheck(QPainter *painter, QRectF r, const QColor &c, bool exclusive, bool rtl, bool sunken, Qt::CheckState state)
+{
+    painter->setRenderHint(QPainter::Antialiasing);
+    painter->setPen(QPen(c, FRAME_STROKE));
+    painter->setBrush(Qt::NoBrush);
+    if (exclusive) {
+        if (rtl)
+            DRAW_SEGMENT(r, 16*84, 16*192);
+        else
+            DRAW_SEGMENT(r, -16*96, 16*192);
+    } else {
+        DRAW_SEGMENT(r, 16*6, -16*192);
+    }
+
+    if (state != Qt::Unchecked) { // the drop
+        painter->setBrush(c);
+        painter->setPen(Qt::NoPen);
+        const int d = intMin(F(4), r.height()/3);
+        r.adjust(d, d, -d, -d);
+        if (state == Qt::PartiallyChecked) // tri-state
+            painter->drawChord(r, -180*16, 180*16);
+        else
+            painter->drawEllipse(r);
+    }
+}
+
+typedef struct {
+    int w, h, fx, fy, stroke;
+    QRgb color;
+    qreal dpr;
+} CheckAtlasKey;
+
 void
 Style::drawCheck(const QStyleOption *option, QPainter *painter, const QWidget *, bool exclusive, bool itemview) const
 {
@@ -35,9 +69,6 @@ Style::drawCheck(const QStyleOption *option, QPainter *painter, const QWidget *,
 
     OPT_SUNKEN OPT_HOVER
 
-    SAVE_PAINTER(Pen|Brush|Alias);
-    painter->setRenderHint(QPainter::Antialiasing);
-
     // rect -> square
     STROKED_RECT(r, RECT);
     if (r.width() > r.height())
@@ -51,44 +82,72 @@ Style::drawCheck(const QStyleOption *option, QPainter *painter, const QWidget *,
         r.moveLeft(RECT.left() + (halfStroke + F(1)));
     r.moveTop(RECT.top() + 0.5*(RECT.height() - r.height()));
 
+    QColor c = painter->pen().color();
     if (itemview) { // itemViewCheck
         if (!exclusive)
             r.translate(0, -r.height()/4);
         if (option->state & State_Selected)
-            painter->setPen(FCOLOR(HighlightedText));
+            c = FCOLOR(HighlightedText);
         else if (hover) // not necessarily selectable...
-            painter->setPen(FX::blend(FCOLOR(Highlight), FCOLOR(HighlightedText)));
+            c = FX::blend(FCOLOR(Highlight), FCOLOR(HighlightedText));
         else
-            painter->setPen(FX::blend(FCOLOR(Base), FCOLOR(Text)));
+            c = DERIVED(baseMid);
     }
 
-    painter->setPen(QPen(painter->pen().color(), FRAME_STROKE));
-    painter->setBrush(Qt::NoBrush);
-    if (exclusive) {
-        if (option->direction == Qt::LeftToRight)
-            DRAW_SEGMENT(r, -16*96, 16*192);
-        else
-            DRAW_SEGMENT(r, 16*84, 16*192);
-    } else {
-        DRAW_SEGMENT(r, 16*6, -16*192);
+    const bool rtl = option->direction != Qt::LeftToRight;
+    // all variants of one size and color share an atlas, item views blit rows from there
+    QRectF local;
+    const QRect cell = PixCache::gridCell(r, halfStroke + 1, &local);
+    PixCache::Atlas *atlas = 0;
+    if (PixCache::accepts(painter, cell.size())) {
+        CheckAtlasKey k; memset(&k, 0, sizeof(k));
+        k.w = cell.width(); k.h = cell.height(); k.stroke = FRAME_STROKE_WIDTH;
+        k.fx = qRound(16*local.x()); k.fy = qRound(16*local.y());
+        k.color = c.rgba(); k.dpr = PixCache::dpr(painter);
+        atlas = PixCache::atlas(PixCache::key('c', k), cell.size(), 24, k.dpr);
     }
-
-    if (state != Qt::Unchecked) { // the drop
-        painter->setBrush(painter->pen().color());
-        painter->setPen(Qt::NoPen);
-        const int d = intMin(F(4), r.height()/3);
-        r.adjust(d, d, -d, -d);
-        if (state == Qt::PartiallyChecked) // tri-state
-            painter->drawChord(r, -180*16, 180*16);
-        else
-            painter->drawEllipse(r);
+    if (!atlas) {
+        SAVE_PAINTER(Pen|Brush|Alias);
+        paintCheck(painter, r, c, exclusive, rtl, sunken, state);
+        RESTORE_PAINTER
+        return;
     }
 
-    RESTORE_PAINTER
+    const int index = ((int(state)*2 + sunken)*2 + rtl)*2 + exclusive;
+    if (PixCache::claimCell(atlas, index)) {
+        QPainter p(&atlas->sprite);
+        const QRect cr = PixCache::cellRect(atlas, index);
+        p.setClipRect(cr);
+        p.translate(cr.topLeft());
+        paintCheck(&p, local, c, exclusive, rtl, sunken, state);
+    }
+    PixCache::drawCell(painter, cell.topLeft(), atlas, index);
 }
 
 #define DRAW_ARROW(_A_) if (painter->brush() == Qt::NoBrush) painter->drawArc(r, _A_*16, 180*16); else painter->drawChord(r, _A_*16, 180*16)
 
+static void
+paintArrow(QPainter *painter, Navi::Direction dir, const QRectF &r)
+{
+    switch (dir) {
+        case Navi::N: DRAW_ARROW(0); break;
+        case Navi::E: DRAW_ARROW(-90); break;
+        case Navi::S: DRAW_ARROW(-180); break;
+        case Navi::W: DRAW_ARROW(90); break;
+        case Navi::NW: DRAW_ARROW(45); break;
+        case Navi::NE: DRAW_ARROW(-45); break;
+        case Navi::SE: DRAW_ARROW(-135); break;
+        case Navi::SW: DRAW_ARROW(135); break;
+    }
+}
+
+typedef struct {
+    int s, penWidth, cap, join;
+    QRgb pen, brush;
+    bool filled;
+    qreal dpr;
+} ArrowAtlasKey;
+
 /**static!*/ void
 Style::drawArrow(Navi::Direction dir, const QRect &rect, QPainter *painter, const QWidget*)
 {
@@ -98,23 +157,47 @@ Style::drawArrow(Navi::Direction dir, const QRect &rect, QPainter *painter, cons
 //         --s;
     QRect r( 0, 0, s, s );
     r.moveCenter(rect.center());
-    SAVE_PAINTER(Alias);
-    painter->setRenderHint(QPainter::Antialiasing, true);
     bool reset_pen = (painter->pen() == Qt::NoPen);
-    if (reset_pen)
-        painter->setPen(QPen(painter->brush(), 1));
+    const QPen pen = reset_pen ? QPen(painter->brush(), 1) : painter->pen();
+    const QBrush brush = painter->brush();
+
+    // plain colored arrows (ie. all of them) are blitted from an atlas of the 8 directions
+    PixCache::Atlas *atlas = 0;
+    QRectF local;
+    QRect cell;
+    const int index = dir - Navi::N; // N .. SW
+    if (index >= 0 && index < 8 && pen.style() == Qt::SolidLine && pen.brush().style() == Qt::SolidPattern &&
+        (brush.style() == Qt::NoBrush || brush.style() == Qt::SolidPattern)) {
+        cell = PixCache::gridCell(r, pen.widthF()/2.0 + 1, &local);
+        if (PixCache::accepts(painter, cell.size())) {
+            ArrowAtlasKey k; memset(&k, 0, sizeof(k));
+            k.s = s; k.penWidth = qRound(16*pen.widthF()); k.cap = pen.capStyle(); k.join = pen.joinStyle();
+            k.pen = pen.color().rgba(); k.filled = brush.style() != Qt::NoBrush;
+            k.brush = k.filled ? brush.color().rgba() : 0; k.dpr = PixCache::dpr(painter);
+            atlas = PixCache::atlas(PixCache::key('a', k), cell.size(), 8, k.dpr);
+        }
+    }
 
-    switch (dir) {
-        case Navi::N: DRAW_ARROW(0); break;
-        case Navi::E: DRAW_ARROW(-90); break;
-        case Navi::S: DRAW_ARROW(-180); break;
-        case Navi::W: DRAW_ARROW(90); break;
-        case Navi::NW: DRAW_ARROW(45); break;
-        case Navi::NE: DRAW_ARROW(-45); break;
-        case Navi::SE: DRAW_ARROW(-135); break;
-        case Navi::SW: DRAW_ARROW(135); break;
+    if (atlas) {
+        if (PixCache::claimCell(atlas, index)) {
+            QPainter p(&atlas->sprite);
+            const QRect cr = PixCache::cellRect(atlas, index);
+            p.setClipRect(cr);
+            p.translate(cr.topLeft());
+            p.setRenderHint(QPainter::Antialiasing, true);
+            p.setPen(pen);
+            p.setBrush(brush);
+            paintArrow(&p, dir, local);
+        }
+        PixCache::drawCell(painter, cell.topLeft(), atlas, index);
+        return;
     }
 
+    SAVE_PAINTER(Alias);
+    painter->setRenderHint(QPainter::Antialiasing, true);
+    if (reset_pen)
+        painter->setPen(pen);
+    paintArrow(painter, dir, r);
     if (reset_pen)
         painter->setPen(Qt::NoPen);
     RESTORE_PAINTER
@@ -17,20 +17,31 @@
  */
 
 #include <QApplication>
+#include <QCryptographicHash>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFontInfo>
 #include <QPainter>
 #include <QProcess>
-#include <QSettings>
 #include <QTimer>
+#if QT_VERSION >= 0x050000
+#include <QScreen>
+#else
+#include <QDesktopWidget>
+#endif
 
 #include <cmath>
+#include <cstring>
 
 #include "animator/tab.h"
 #include "virtuality.h"
+#include "diskcache.h"
 #include "hacks.h"
+#include "pixcache.h"
+#include "profiler.h"
+#include "snapshot.h"
 #include "makros.h"
-#include "config.defaults"
 
 #include <QtDebug>
 
@@ -96,12 +107,50 @@ offset:
 }
 #endif
 
-#define readInt(_DEF_) iSettings->value(_DEF_).toInt()
-#define readBool(_DEF_) iSettings->value(_DEF_).toBool()
-#define readRole(_VAR_, _DEF_)\
-config._VAR_##_role[0] = (QPalette::ColorRole) iSettings->value(_DEF_).toInt();\
-FX::counterRole(config._VAR_##_role[0], config._VAR_##_role[1])
-//, QPalette::_DEF_, FX::counterRole(QPalette::_DEF_))
+/**
+ * Measuring renders and scans a string per font weight on every startup, but the result only
+ * depends on the font and the resolution - so it's kept in the disk cache
+ */
+typedef struct {
+    qint32 offset[2], extent;
+} FontOffsets;
+
+static QByteArray
+fontOffsetKey()
+{
+    const QFont font;
+#if QT_VERSION >= 0x050000
+    const qreal dpi = QGuiApplication::primaryScreen() ? QGuiApplication::primaryScreen()->logicalDotsPerInchY() : 96.0;
+#else
+    const qreal dpi = QApplication::desktop()->logicalDpiY();
+#endif
+    // the resolved family catches fontconfig changes, Qt might render differently
+    const QByteArray description = font.toString().toUtf8() + '|' + QFontInfo(font).family().toUtf8() + '|' +
+                                   QByteArray::number(dpi) + '|' + qVersion();
+    return "fontoffset-" + QCryptographicHash::hash(description, QCryptographicHash::Md5).toHex();
+}
+
+static FontOffsets
+fontOffsets()
+{
+    FontOffsets offsets;
+    Profiler::PhaseTimer time; time.start();
+    const QByteArray key = fontOffsetKey();
+    QByteArray data;
+    if (DiskCache::loadData(key, &data) && data.size() == int(sizeof(FontOffsets))) {
+        memcpy(&offsets, data.constData(), sizeof(FontOffsets));
+        PROFILE_PHASE("fontOffset (cached)", time);
+        return offsets;
+    }
+    int extent;
+    offsets.offset[0] = fontOffset(false, &extent);
+    PROFILE_PHASE("fontOffset (regular)", time);
+    offsets.offset[1] = fontOffset(true);
+    PROFILE_PHASE("fontOffset (bold)", time);
+    offsets.extent = extent;
+    DiskCache::storeData(key, QByteArray(reinterpret_cast<const char*>(&offsets), sizeof(FontOffsets)));
+    return offsets;
+}
 
 void
 Style::removeAppEventFilter()
@@ -121,90 +170,90 @@ Style::setMenuIconsVisible(bool vis)
 void
 Style::readSettings(QString appName)
 {
-    QSettings *iSettings = new QSettings("BE", "Style");
-    iSettings->beginGroup("Current");
+    Snapshot::Settings settings;
+    if (!Snapshot::load(&settings))
+        Snapshot::compile(&settings);
     //BEGIN read some user personal settings (i.e. not preset related)
-    config.leftHanded = readBool(LEFTHANDED) ? Qt::RightToLeft : Qt::LeftToRight;
+    config.leftHanded = settings.leftHanded ? Qt::RightToLeft : Qt::LeftToRight;
     // item single vs. double click, wizard appereance
-    config.macStyle = readBool(MACSTYLE);
-    config.dialogBtnLayout = readInt(DIALOG_BTN_LAYOUT);
-    config.fadeInactive = readBool(FADE_INACTIVE);
+    config.macStyle = settings.macStyle;
+    config.dialogBtnLayout = settings.dialogBtnLayout;
+    config.fadeInactive = settings.fadeInactive;
     // Hacks ==================================
-    Hacks::config.windowMovement = readBool(HACK_WINDOWMOVE);
-    Hacks::config.fixGwenview = readBool(HACK_FIX_GWENVIEW);
-    Hacks::config.lockToolBars = readBool(HACK_TOOLBAR_LOCKING);
-    Hacks::config.lockDocks = readBool(HACK_DOCK_LOCKING);
-    Hacks::config.panning = readBool(HACK_PANNING);
-    Hacks::config.suspendFullscreenPlayers = readBool(HACK_SUSPEND_FULLSCREEN_PLAYERS);
+    Hacks::config.windowMovement = settings.hack.windowMovement;
+    Hacks::config.fixGwenview = settings.hack.fixGwenview;
+    Hacks::config.lockToolBars = settings.hack.lockToolBars;
+    Hacks::config.lockDocks = settings.hack.lockDocks;
+    Hacks::config.panning = settings.hack.panning;
+    Hacks::config.suspendFullscreenPlayers = settings.hack.suspendFullscreenPlayers;
     if (Hacks::config.suspendFullscreenPlayers)
         Hacks::config.suspendFullscreenPlayers = (  appName == "dragonplayer" || appName == "smplayer" ||
                                                     appName == "minitube" || appName == "vlc"  );
-    Hacks::config.titleWidgets = readBool(HACK_TITLE_WIDGET);
-    Hacks::config.suppressBrightnessOSD = readBool(HACK_BRIGHTNESS_OSD);
+    Hacks::config.titleWidgets = settings.hack.titleWidgets;
+    Hacks::config.suppressBrightnessOSD = settings.hack.suppressBrightnessOSD;
 
     // Font fixing offsets
-    config.fontOffset[0] = fontOffset(false, &config.fontExtent);
-    config.fontExtent = iSettings->value( "FontExtent", config.fontExtent ).toInt();
-    config.fontOffset[1] = fontOffset(true);
-    QStringList lst = iSettings->value( "FontOffset", QStringList() ).toStringList();
-    if ( lst.count() > 0 )
+    const FontOffsets offsets = fontOffsets();
+    config.fontOffset[0] = offsets.offset[0];
+    config.fontExtent = settings.hasFontExtent ? settings.fontExtent : offsets.extent;
+    config.fontOffset[1] = offsets.offset[1];
+    if ( settings.fontOffsets > 0 )
     {
-        config.fontOffset[0] = lst.at(0).toInt();
-        if ( lst.count() > 1 )
-            config.fontOffset[1] = lst.at(1).toInt();
+        config.fontOffset[0] = settings.fontOffset[0];
+        if ( settings.fontOffsets > 1 )
+            config.fontOffset[1] = settings.fontOffset[1];
         else
             config.fontOffset[1] = config.fontOffset[0];
     }
 
     // PW Echo Char ===========================
-    config.input.pwEchoChar = ushort(iSettings->value(INPUT_PWECHOCHAR).toUInt());
+    config.input.pwEchoChar = settings.pwEchoChar;
 
-    config.menu.delay = readInt(MENU_DELAY);
-    const bool menuIconsVis = readBool(MENU_SHOWICONS);
+    config.menu.delay = settings.menu.delay;
+    const bool menuIconsVis = settings.menu.showIcons;
     // allow (K)Application to manipulate this first
     QMetaObject::invokeMethod(this, "setMenuIconsVisible", Qt::QueuedConnection, Q_ARG(bool, menuIconsVis));
-    config.menu.indent = readBool(MENU_INDENT);
+    config.menu.indent = settings.menu.indent;
 
     config.winBtnStyle = 2; // this is a kwin deco setting, TODO: read from there?
 
-    Animator::Tab::setTransition((Animator::Transition) readInt(TAB_TRANSITION));
+    Animator::Tab::setTransition((Animator::Transition) settings.tab.transition);
     if (appType == Falkon)
         Animator::Tab::setTransition(Animator::Jump);
-    Animator::Tab::setDuration(clamp(iSettings->value(TAB_DURATION).toUInt(), 150, 4000));
+    Animator::Tab::setDuration(clamp(settings.tab.duration, 150, 4000));
     //END personal settings
-    //NOTICE we do not end group here, but below. this way it's open if we don't make use of presets
 
     // Background ===========================
-    config.invert.docks = readBool(INVERT_DOCKS);
-    config.invert.headers = readBool(INVERT_HEADERS);
+    config.invert.docks = settings.invert.docks;
+    config.invert.headers = settings.invert.headers;
     if (appName == "sqriptor")
         config.invert.headers = false;
-    config.invert.menubars = readBool(INVERT_MENUBARS);
-    config.invert.menus = readBool(INVERT_MENUS);
-    config.invert.modals = (appType != KDM) && readBool(INVERT_MODALS);
-    config.invert.titlebars = readBool(INVERT_TITLEBARS);
-    config.invert.toolbars = readBool(INVERT_TOOLBARS);
-
-    config.bg.opacity = readInt(BG_OPACITY);
-    config.bg.modal.opacity = readInt(BG_MODAL_OPACITY);
+    config.invert.menubars = settings.invert.menubars;
+    config.invert.menus = settings.invert.menus;
+    config.invert.modals = (appType != KDM) && settings.invert.modals;
+    config.invert.titlebars = settings.invert.titlebars;
+    config.invert.toolbars = settings.invert.toolbars;
+
+    config.bg.opacity = settings.bg.opacity;
+    config.bg.modal.opacity = settings.bg.modalOpacity;
     if (config.bg.opacity || config.bg.modal.opacity)
-        config.bg.blur = readBool(BG_BLUR);
+        config.bg.blur = settings.bg.blur;
     else
         config.bg.blur = false;
 
-    config.bg.ringOverlay = readInt(BG_RING_OVERLAY);
+    config.bg.ringOverlay = settings.bg.ringOverlay;
 
 
     // Buttons ===========================
-    config.btn.minHeight = readInt(BTN_MIN_HEIGHT);
+    config.btn.minHeight = settings.btn.minHeight;
 
     // .Tool
-    config.btn.tool.disabledStyle = readInt(BTN_DISABLED_TOOLS);
+    config.btn.tool.disabledStyle = settings.btn.disabledToolStyle;
 
     //--------
-    config.slider.buttons = readBool(SLIDER_BUTTONS);
+    config.slider.buttons = settings.slider.buttons;
 
-    if (readBool(SHOW_MNEMONIC))
+    if (settings.showMnemonic)
         config.mnemonic = Qt::TextShowMnemonic;
     else
         config.mnemonic = Qt::TextHideMnemonic;
@@ -237,10 +286,10 @@ Style::readSettings(QString appName)
         }
     }
 
-    config.slider.thickness = SCALE(qMax(2,readInt(SLIDER_THICKNESS)));
-    config.frame.roundness = SCALE(qMax(0,readInt(ROUNDNESS)));
-//     config.strokeWidth = qMin(config.frame.roundness, SCALE(readInt(STROKE_WIDTH)));
-    config.strokeWidth = SCALE(qMax(0,readInt(STROKE_WIDTH)));
+    config.slider.thickness = SCALE(qMax(2,settings.slider.thickness));
+    config.frame.roundness = SCALE(qMax(0,settings.roundness));
+//     config.strokeWidth = qMin(config.frame.roundness, SCALE(settings.strokeWidth));
+    config.strokeWidth = SCALE(qMax(0,settings.strokeWidth));
     halfStroke = 0.5*config.strokeWidth;
 
     //NOTICE gtk-qt fails on several features
@@ -253,14 +302,8 @@ Style::readSettings(QString appName)
         config.invert.docks = config.invert.menubars = config.invert.menus = config.invert.modals =
         config.invert.toolbars = config.invert.headers = false;
     }
-
-    delete iSettings;
-
 }
 
-#undef readRole
-#undef gradientType
-
 void Style::initMetrics()
 {
     BE::Dpi::target.f1 = SCALE(1); BE::Dpi::target.f2 = SCALE(2);
@@ -277,12 +320,10 @@ void Style::initMetrics()
 
 #undef SCALE
 
-extern const QString virtuality_revision();
-
 void
 Style::init()
 {
-    QElapsedTimer time; time.start();
+    Profiler::PhaseTimer time; time.start();
     // various workarounds... ==========================
     appType = Unknown;
     QString appName;
@@ -335,8 +376,10 @@ Style::init()
     }
 
     // ==========================
+    PROFILE_PHASE("app type detection", time);
 
     readSettings(appName);
+    PROFILE_PHASE("readSettings", time);
 
     if (objectName() == "sienar") {
         config.invert.docks = true;
@@ -378,6 +421,7 @@ Style::init()
         config.bg.ringOverlay = 4;
     }
     initMetrics();
-    setProperty("VirtualityStyleRevision", virtuality_revision());
+    PixCache::clear(); // metrics, stroke or button style may have changed
+    PROFILE_PHASE("initMetrics", time);
 }
 
@@ -20,8 +20,10 @@
 #include <QComboBox>
 #include <QPainterPath>
 #include <QToolBar>
+#include <qmath.h>
 #include "draw.h"
 #include "hacks.h"
+#include "pixcache.h"
 #include "animator/focus.h"
 #include "animator/hover.h"
 
@@ -29,6 +31,75 @@
 #define MAX_STEPS Animator::Hover::maxSteps()
 #define LEF_COLOR FX::blend(FCOLOR(Window), FCOLOR(WindowText), 8, isEnabled+1)
 
+// underline from bottom + x, round cap on the right and the top line back to top + x
+static QPainterPath
+lineEditPath(const QRect &rect, int bottom, int top)
+{
+    STROKED_RECT(r, rect);
+    QRectF r2(r);
+    r2.setWidth(r2.height());
+    r2.moveRight(r.right());
+    QPainterPath path;
+    path.moveTo(r.x() + bottom, r.bottom());
+    path.lineTo(r2.bottomLeft());
+    path.arcTo(r2, -90, 180);
+    path.lineTo(r.x() + top, r.y());
+    return path;
+}
+
+/**
+ * Forms with hundreds of line edits would fill the same path over and over again.
+ * The sprite is the shape at minimal width: | 2l: line caps | line | right cap |
+ * Both lines are composed from their cap and the stretched line column, so only the height matters.
+ */
+static void
+drawLineEditPath(QPainter *painter, const QRect &rect, int bottom, int top)
+{
+    const int stroke = qCeil(painter->pen().widthF());
+    const int l = stroke + 1, h = rect.height(), h2 = h/2;
+    const int capR = qCeil(h/2.0 + stroke) + 1;
+    const int rightCap = rect.right() + 1 - capR;
+    const QSize size(qMax(2*l + 1 + capR, h + 2*l + 1), h); // the underline must not run into the left caps
+    if (rect.x() + qMax(bottom, top) + l > rightCap || !PixCache::accepts(painter, size)) {
+        painter->drawPath(lineEditPath(rect, bottom, top));
+        return;
+    }
+
+    struct {
+        int h;
+        float stroke;
+        QRgb color;
+        qreal dpr;
+    } k;
+    memset(&k, 0, sizeof(k));
+    k.h = h; k.stroke = painter->pen().widthF(); k.color = painter->pen().color().rgba(); k.dpr = PixCache::dpr(painter);
+    const QByteArray key = PixCache::key('l', k);
+    QPixmap sprite;
+    if (!PixCache::find(key, &sprite)) {
+        sprite = PixCache::pixmap(size, k.dpr);
+        QPainter p(&sprite);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(painter->pen());
+        p.drawPath(lineEditPath(QRect(QPoint(0,0), size), l, l));
+        p.end();
+        PixCache::insert(key, sprite);
+    }
+
+    QVector<QPainter::PixmapFragment> fragments;
+    fragments.reserve(5);
+    const qreal dpr = k.dpr;
+    const int x = rect.x(), y = rect.y();
+    PixCache::addFragment(fragments, QRectF(size.width() - capR, 0, capR, h), QRectF(rightCap, y, capR, h), dpr);
+    // bottom line
+    PixCache::addFragment(fragments, QRectF(0, h2, 2*l, h - h2), QRectF(x + bottom - l, y + h2, 2*l, h - h2), dpr);
+    PixCache::addFragment(fragments, QRectF(2*l, h2, 1, h - h2),
+                                     QRectF(x + bottom + l, y + h2, rightCap - (x + bottom + l), h - h2), dpr);
+    // top line
+    PixCache::addFragment(fragments, QRectF(0, 0, 2*l, h2), QRectF(x + top - l, y, 2*l, h2), dpr);
+    PixCache::addFragment(fragments, QRectF(2*l, 0, 1, h2), QRectF(x + top + l, y, rightCap - (x + top + l), h2), dpr);
+    painter->drawPixmapFragments(fragments.constData(), fragments.count(), sprite);
+}
+
 void
 Style::drawLineEditFrame(const QStyleOption *option, QPainter *painter, const QWidget *widget) const
 {
@@ -38,19 +109,10 @@ Style::drawLineEditFrame(const QStyleOption *option, QPainter *painter, const QW
     }
     OPT_ENABLED OPT_FOCUS
     SAVE_PAINTER(Pen|Alias);
-    STROKED_RECT(r, RECT);
-    QRectF r2(r);
-    r2.setWidth(r2.height());
-    r2.moveRight(r.right());
-    QPainterPath path;
-    path.moveTo(r.x() + config.frame.roundness, r.bottom()); // +config.frame.roundness to match aligned fames
-    path.lineTo(r2.bottomLeft());
-    path.arcTo(r2, -90, 180);
     const int max = Animator::Focus::maxSteps();
     int step = widget ? Animator::Focus::step(widget) : max;
     if (!step && hasFocus)
         step = max;
-    path.lineTo(r.x() + ((2*max - step)*r.width())/(3*max), r.y());
     QColor c;
     bool goodBad = false;
     if (widget && widget->testAttribute(Qt::WA_SetPalette)) {
@@ -60,15 +122,15 @@ Style::drawLineEditFrame(const QStyleOption *option, QPainter *painter, const QW
             c = FX::blend(Qt::red, LEF_COLOR, 1, 16-15*hasFocus);
         else if ((goodBad = (g > r+b && qAbs(r-b) < qMax(qMin(r,b)/10,1)))) // that's green
             c = FX::blend(Qt::green, LEF_COLOR, 1, 16-15*hasFocus);
-        if (goodBad)
-            painter->setPen(QPen(c, FRAME_STROKE));
     }
     if (!goodBad) {
-        painter->setPen(QPen(FX::blend(FX::blend(FCOLOR(Window), FCOLOR(WindowText), 8, 1),
-                             FX::blend(FCOLOR(Window), FCOLOR(Highlight), 1, 2), max - step, step), FRAME_STROKE));
+        c = FX::blend(FRAME_COLOR, DERIVED(focusFrame), max - step, step);
     }
+    painter->setPen(QPen(c, FRAME_STROKE));
     painter->setRenderHint(QPainter::Antialiasing, true);
-    painter->drawPath(path);
+    // +config.frame.roundness to match aligned fames
+    const int top = ((2*max - step)*(RECT.width() - FRAME_STROKE_WIDTH))/(3*max);
+    drawLineEditPath(painter, RECT, config.frame.roundness, top);
     RESTORE_PAINTER
 }
 
@@ -98,7 +160,7 @@ Style::drawLineEdit(const QStyleOption *option, QPainter *painter, const QWidget
         OPT_FOCUS
         SAVE_PAINTER(Pen|Alias|Brush);
         painter->setPen(Qt::NoPen);
-        painter->setBrush(hasFocus ? FX::blend(FCOLOR(Base), FCOLOR(Highlight), 6, 1) : FCOLOR(Base));
+        painter->setBrush(hasFocus ? DERIVED(baseFocus) : FCOLOR(Base));
         painter->setRenderHint(QPainter::Antialiasing, true);
         const int rnd = (RECT.height()-1)/2;
         const int d = FRAME_STROKE_WIDTH;
@@ -138,7 +200,7 @@ drawSBArrow(QStyle::SubControl sc, QPainter *painter, QStyleOptionSpinBox *optio
     if (hover)
         c = FCOLOR(Highlight);
     else if (isEnabled)
-        c = FX::blend(FCOLOR(Base), FCOLOR(Text));
+        c = DERIVED(baseMid);
     else
         c = FX::blend(FCOLOR(Base), FCOLOR(QPalette::Text),5,1);
 
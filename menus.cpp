@@ -182,7 +182,7 @@ Style::drawMenuItem(const QStyleOption *option, QPainter *painter, const QWidget
     else if (config.menu.indent)
         c = FX::blend(FCOLOR(Window), FCOLOR(WindowText), 1, 3);
     else
-        c = FX::blend(FCOLOR(Window), FCOLOR(WindowText));
+        c = DERIVED(windowMid);
 
     if (subMenu) { // draw sub menu arrow ================================
         int dim = (5*r.height()/12) | 1;
@@ -0,0 +1,198 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QCache>
+#include <QPainter>
+#include <QPaintDevice>
+#include <qmath.h>
+
+#include "pixcache.h"
+
+using namespace BE;
+
+// KiB, sprites are supposed to be small
+#define BUDGET 4096
+// larger things are rare and the blit does not pay the memory
+#define MAX_AREA 256*256
+
+#define ATLAS_COLUMNS 8
+
+static QCache<QByteArray, QPixmap> gs_cache(BUDGET);
+static QCache<QByteArray, PixCache::Atlas> gs_atlases(BUDGET/4);
+
+static int
+pixmapCost(const QPixmap &pix)
+{
+    return qMax(1, pix.width()*pix.height()*pix.depth()/(8*1024));
+}
+
+bool
+PixCache::accepts(const QPainter *p, const QSize &size)
+{
+    if (size.isEmpty() || size.width()*size.height() > MAX_AREA)
+        return false;
+    if (p->transform().type() > QTransform::TxTranslate)
+        return false;
+    const QPaintDevice *device = p->device();
+    return device && device->devType() != QInternal::Printer && device->devType() != QInternal::Picture;
+}
+
+qreal
+PixCache::dpr(const QPainter *p)
+{
+#if QT_VERSION >= 0x050600
+    return p->device() ? p->device()->devicePixelRatioF() : 1.0;
+#else
+    Q_UNUSED(p);
+    return 1.0;
+#endif
+}
+
+QPixmap
+PixCache::pixmap(const QSize &size, qreal dpr)
+{
+#if QT_VERSION >= 0x050000
+    QPixmap pix(size*dpr);
+    pix.setDevicePixelRatio(dpr);
+#else
+    Q_UNUSED(dpr);
+    QPixmap pix(size);
+#endif
+    pix.fill(Qt::transparent);
+    return pix;
+}
+
+bool
+PixCache::find(const QByteArray &key, QPixmap *pix)
+{
+    if (const QPixmap *cached = gs_cache.object(key)) {
+        *pix = *cached;
+        return true;
+    }
+    return false;
+}
+
+void
+PixCache::insert(const QByteArray &key, const QPixmap &pix)
+{
+    gs_cache.insert(key, new QPixmap(pix), pixmapCost(pix));
+}
+
+void
+PixCache::clear()
+{
+    gs_cache.clear();
+    gs_atlases.clear();
+}
+
+PixCache::Atlas *
+PixCache::atlas(const QByteArray &key, const QSize &cellSize, int cells, qreal dpr)
+{
+    if (Atlas *atlas = gs_atlases.object(key))
+        return atlas;
+    cells = qBound(1, cells, int(MaxAtlasCells));
+    const int columns = qMin(cells, ATLAS_COLUMNS);
+    Atlas *atlas = new Atlas;
+    atlas->sprite = pixmap(QSize(columns*cellSize.width(), ((cells + columns - 1)/columns)*cellSize.height()), dpr);
+    atlas->cell = cellSize;
+    atlas->painted = 0;
+    const int cost = pixmapCost(atlas->sprite);
+    if (cost > gs_atlases.maxCost()) {
+        delete atlas;
+        return 0;
+    }
+    gs_atlases.insert(key, atlas, cost);
+    return atlas;
+}
+
+QRect
+PixCache::cellRect(const Atlas *atlas, int index)
+{
+    return QRect(QPoint((index % ATLAS_COLUMNS)*atlas->cell.width(), (index / ATLAS_COLUMNS)*atlas->cell.height()), atlas->cell);
+}
+
+bool
+PixCache::claimCell(Atlas *atlas, int index)
+{
+    const quint64 bit = quint64(1) << index;
+    if (atlas->painted & bit)
+        return false;
+    atlas->painted |= bit;
+    return true;
+}
+
+void
+PixCache::drawCell(QPainter *p, const QPoint &pos, const Atlas *atlas, int index)
+{
+#if QT_VERSION >= 0x050000
+    const qreal dpr = atlas->sprite.devicePixelRatio();
+#else
+    const qreal dpr = 1.0;
+#endif
+    QVector<QPainter::PixmapFragment> fragment;
+    addFragment(fragment, cellRect(atlas, index), QRectF(pos, atlas->cell), dpr);
+    p->drawPixmapFragments(fragment.constData(), fragment.count(), atlas->sprite);
+}
+
+QRect
+PixCache::gridCell(const QRectF &rect, qreal margin, QRectF *local)
+{
+    const QPoint tl(qFloor(rect.left() - margin), qFloor(rect.top() - margin));
+    const QPoint br(qCeil(rect.right() + margin), qCeil(rect.bottom() + margin));
+    *local = rect.translated(-tl);
+    return QRect(tl, QSize(br.x() - tl.x(), br.y() - tl.y()));
+}
+
+void
+PixCache::addFragment(QVector<QPainter::PixmapFragment> &fragments, const QRectF &source, const QRectF &target, qreal dpr)
+{
+    if (source.isEmpty() || target.isEmpty())
+        return;
+    // source rects address device pixels, the target size is source size * scale
+    const QRectF src(source.x()*dpr, source.y()*dpr, source.width()*dpr, source.height()*dpr);
+    fragments << QPainter::PixmapFragment::create(target.center(), src, target.width()/src.width(),
+                                                                        target.height()/src.height());
+}
+
+void
+PixCache::drawNineSlice(QPainter *p, const QRect &rect, const QPixmap &sprite, const QMargins &slices, int pieces)
+{
+#if QT_VERSION >= 0x050000
+    const qreal dpr = sprite.devicePixelRatio();
+#else
+    const qreal dpr = 1.0;
+#endif
+    const int sw = qRound(sprite.width()/dpr), sh = qRound(sprite.height()/dpr);
+    const int sx[4] = { 0, slices.left(), sw - slices.right(), sw };
+    const int sy[4] = { 0, slices.top(), sh - slices.bottom(), sh };
+    const int tx[4] = { rect.x(), rect.x() + slices.left(), rect.right() + 1 - slices.right(), rect.right() + 1 };
+    const int ty[4] = { rect.y(), rect.y() + slices.top(), rect.bottom() + 1 - slices.bottom(), rect.bottom() + 1 };
+
+    QVector<QPainter::PixmapFragment> fragments;
+    fragments.reserve(9);
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            if (!(pieces & (1 << (3*row + col))))
+                continue;
+            addFragment(fragments, QRectF(sx[col], sy[row], sx[col+1] - sx[col], sy[row+1] - sy[row]),
+                                   QRectF(tx[col], ty[row], tx[col+1] - tx[col], ty[row+1] - ty[row]), dpr);
+        }
+    }
+    if (!fragments.isEmpty())
+        p->drawPixmapFragments(fragments.constData(), fragments.count(), sprite);
+}
@@ -0,0 +1,93 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BE_PIXCACHE_H
+#define BE_PIXCACHE_H
+
+#include <QByteArray>
+#include <QMargins>
+#include <QPainter>
+#include <QPixmap>
+#include <QVector>
+#include <cstring>
+
+namespace BE {
+namespace PixCache {
+
+/**
+ * Prerendered sprites for the draw routines
+ * Keys are a tag char + the raw bytes of a POD struct - memset() it first, padding counts!
+ * All sprites share one budget and do not compete with the applications QPixmapCache
+ */
+
+template <typename T> inline QByteArray
+key(char tag, const T &data)
+{
+    QByteArray k(int(sizeof(T)) + 1, Qt::Uninitialized);
+    k[0] = tag;
+    memcpy(k.data() + 1, &data, sizeof(T));
+    return k;
+}
+
+// whether it's sane to paint a sprite of this size on this painter (no scaling, printing etc.)
+bool accepts(const QPainter *p, const QSize &size);
+qreal dpr(const QPainter *p);
+// transparent pixmap of logical size, ready to paint on
+QPixmap pixmap(const QSize &size, qreal dpr);
+bool find(const QByteArray &key, QPixmap *pix);
+void insert(const QByteArray &key, const QPixmap &pix);
+void clear();
+
+/**
+ * Nine-slice composition. The sprite is rendered once at some minimal size, the margins
+ * (logical pixels) cut it into corners, edges and center. Corners are copied 1:1, edges and
+ * center are stretched - pieces tells which of them carry paint at all.
+ * Everything goes out with a single drawPixmapFragments call
+ */
+enum Piece { TopLeft = 1<<0, Top = 1<<1, TopRight = 1<<2,
+             Left = 1<<3, Center = 1<<4, Right = 1<<5,
+             BottomLeft = 1<<6, Bottom = 1<<7, BottomRight = 1<<8,
+             Corners = TopLeft|TopRight|BottomLeft|BottomRight,
+             Frame = Corners|Top|Left|Right|Bottom, All = Frame|Center };
+void drawNineSlice(QPainter *p, const QRect &rect, const QPixmap &sprite, const QMargins &slices, int pieces = Frame);
+// source (logical sprite coordinates) stretched onto target, for custom compositions
+void addFragment(QVector<QPainter::PixmapFragment> &fragments, const QRectF &source, const QRectF &target, qreal dpr);
+
+/**
+ * Atlases hold related glyphs (states, directions, ...) of one size and color in equally sized
+ * cells of a single sprite. Cells are painted on first use: if claimCell() says so, paint
+ * the glyph into atlas->sprite at cellRect()
+ * Atlases are evicted like sprites, ie. the pointer is only valid until the next atlas()
+ */
+struct Atlas {
+    QPixmap sprite;
+    QSize cell;
+    quint64 painted; // bit per cell
+};
+enum { MaxAtlasCells = 64 };
+Atlas *atlas(const QByteArray &key, const QSize &cellSize, int cells, qreal dpr);
+QRect cellRect(const Atlas *atlas, int index);
+bool claimCell(Atlas *atlas, int index);
+void drawCell(QPainter *p, const QPoint &pos, const Atlas *atlas, int index);
+// the pixel aligned cell around rect (grown by margin), *local receives rect in cell coordinates
+QRect gridCell(const QRectF &rect, qreal margin, QRectF *local);
+
+}
+}
+
+#endif // BE_PIXCACHE_H
@@ -34,6 +34,7 @@
 #include <QMenuBar>
 #include <QPainter>
 #include <QPushButton>
+#include <QSet>
 #include <QTimer>
 #include <QToolBar>
 #include <QToolTip>
@@ -57,8 +58,10 @@
 #include <unistd.h>
 #endif
 #include <cmath>
+#include <cstring>
 
 #include "FX.h"
+#include "pixcache.h"
 #include "shadows.h"
 
 #ifndef QT_NO_DBUS
@@ -69,6 +72,7 @@
 #include "fixx11h.h"
 #endif
 
+#include "cyclequeue.h"
 #include "hacks.h"
 #include "virtuality.h"
 
@@ -90,6 +94,64 @@ using namespace BE;
 
 Hacks::Config Hacks::config;
 
+// X11 properties for the deco ---------------
+#ifndef QT_NO_DBUS
+#define MSG(_FNC_) QDBusMessage::createMethodCall( "org.kde.kwin", "/BespinDeco", "org.kde.BespinDeco", _FNC_ )
+#define KWIN_SEND( _MSG_ ) QDBusConnection::sessionBus().send( _MSG_ )
+#else
+#define MSG(_FNC_) void(0)
+#define KWIN_SEND( _MSG_ ) void(0)
+#endif
+
+#ifdef BE_WS_X11
+namespace BE {
+static inline bool
+operator==(const WindowData &d1, const WindowData &d2)
+{
+    return !memcmp(&d1, &d2, sizeof(WindowData));
+}
+}
+
+/**
+ * The deco hints of each window - a palette change storm ends up as (at most) one property
+ * write and one message per window.
+ */
+class DecoHints : public WindowExport<WindowData>
+{
+public:
+    void request(QWidget *window, const WindowData &data, bool dropPics)
+    {
+        if (dropPics)
+            m_dropPics.insert(window);
+        WindowExport<WindowData>::request(window, data);
+    }
+protected:
+    void exportValue(QWidget *window, const WindowData &data)
+    {
+        const WId id = window->winId();
+        BE::XProperty::set<uint>(id, BE::XProperty::winData, (uint*)&data, BE::XProperty::WORD, 9);
+        if (m_dropPics.contains(window))
+            BE::XProperty::remove(id, BE::XProperty::bgPics);
+        m_updated << id;
+    }
+    void process()
+    {
+        WindowExport<WindowData>::process();
+        m_dropPics.clear(); // unchanged hints keep their pictures
+        if (m_updated.isEmpty())
+            return;
+        BE::XProperty::flush(); // the deco reads it on the message
+        foreach (const WId id, m_updated)
+            KWIN_SEND( MSG("updateDeco") << (uint)id );
+        m_updated.clear();
+    }
+private:
+    QSet<const QWidget*> m_dropPics;
+    QList<WId> m_updated;
+};
+static DecoHints gs_decoHints;
+#endif
+
 static inline void
 setBoldFont(QWidget *w, bool bold = true)
 {
@@ -129,6 +191,8 @@ void Style::polish( QPalette &pal, bool onInit )
     pal.setColor( QPalette::Window, c );
 
     if (onInit) {
+        PixCache::clear(); // sprites are keyed by color, but won't be asked for anymore
+        invalidateDerivedColors();
         _ALIGN_COLOR_(Button, Window);
         _ALIGN_COLOR_(ButtonText, WindowText);
         _ALIGN_COLOR_(Base, Window);
@@ -1050,6 +1114,7 @@ Style::unpolish( QWidget *widget )
 //         }
 #ifdef BE_WS_X11
         if (BE::isPlatformX11()) { // TODO: port XProperty for wayland
+            gs_decoHints.forget(widget);
             BE::XProperty::remove(widget->winId(), BE::XProperty::winData);
             BE::XProperty::remove(widget->winId(), BE::XProperty::bgPics);
         }
@@ -1078,17 +1143,8 @@ Style::unpolish( QWidget *widget )
     widget->removeEventFilter(this);
 }
 
-// X11 properties for the deco ---------------
-#ifndef QT_NO_DBUS
-#define MSG(_FNC_) QDBusMessage::createMethodCall( "org.kde.kwin", "/BespinDeco", "org.kde.BespinDeco", _FNC_ )
-#define KWIN_SEND( _MSG_ ) QDBusConnection::sessionBus().send( _MSG_ )
-#else
-#define MSG(_FNC_) void(0)
-#define KWIN_SEND( _MSG_ ) void(0)
-#endif
-
 void
-Style::setupDecoFor(QWidget *widget, const QPalette &palette)
+Style::setupDecoFor(QWidget *widget, const QPalette &palette, bool dropPics)
 {
 #ifdef BE_WS_X11
     if (!BE::isPlatformX11())
@@ -1145,11 +1201,14 @@ Style::setupDecoFor(QWidget *widget, const QPalette &palette)
         data.activeButton = data.activeText = pal.color(QPalette::Active, QPalette::WindowText).rgba();
 
     if (widget) {
-        WId id = widget->winId();
-        BE::XProperty::set<uint>(id, BE::XProperty::winData, (uint*)&data, BE::XProperty::WORD, 9);
-        //         XSync(QX11Info::display(), False);
-        KWIN_SEND( MSG("updateDeco") << (uint)id );
+        gs_decoHints.request(widget, data, dropPics);
     } else {   // dbus solution, currently for gtk
+        static WindowData sent;
+        static bool haveSent = false;
+        if (haveSent && !memcmp(&sent, &data, sizeof(WindowData)))
+            return;
+        sent = data;
+        haveSent = true;
         QByteArray ba(36, 'a');
         uint *ints = (uint*)ba.data();
         ints[0] = data.inactiveWindow;
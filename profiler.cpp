@@ -0,0 +1,252 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMetaEnum>
+#include <QPair>
+#include <QStyle>
+#include <QWidget>
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+
+#include "profiler.h"
+
+using namespace BE;
+
+bool Profiler::paintActive = false;
+bool Profiler::startupActive = false;
+
+// log2 buckets in µs: [0] < 1µs, [1] < 2µs, [2] < 4µs ... [15] >= 16ms
+#define N_BUCKETS 16
+
+struct PaintStat {
+    PaintStat() : calls(0), total(0), max(0) { memset(histogram, 0, sizeof(histogram)); }
+    quint64 calls;
+    qint64 total, max;
+    quint32 histogram[N_BUCKETS];
+};
+
+// kind and element in the upper and lower 32 bits. className() is a static string
+// per meta object, so the pointer is good enough to tell classes apart
+typedef QPair<qint64, const char*> PaintKey;
+static QHash<PaintKey, PaintStat> gs_paintStats;
+static QElapsedTimer gs_clock;
+static QByteArray gs_paintTarget, gs_startupTarget;
+
+typedef struct {
+    const char *name;
+    qint64 ns;
+    int first; // the nested phases are [first, own index)
+} Phase;
+static QList<Phase> gs_phases;
+static volatile sig_atomic_t gs_dumpRequested = 0;
+
+static void
+requestDump(int)
+{
+    gs_dumpRequested = 1; // not safe to print from here, the next paint will
+}
+
+void
+Profiler::init()
+{
+    if (gs_clock.isValid())
+        return; // the style may be created more than once per process
+    gs_clock.start();
+    gs_startupTarget = qgetenv("VIRTUALITY_STARTUP_PROFILE");
+    startupActive = !(gs_startupTarget.isEmpty() || gs_startupTarget == "0");
+    gs_paintTarget = qgetenv("VIRTUALITY_PAINT_PROFILE");
+    paintActive = !(gs_paintTarget.isEmpty() || gs_paintTarget == "0");
+    if (!paintActive)
+        return;
+#ifdef SIGUSR1
+    signal(SIGUSR1, requestDump);
+#endif
+    qAddPostRoutine(dumpPaint);
+}
+
+qint64
+Profiler::now()
+{
+    return gs_clock.nsecsElapsed() + 1; // 0 means "not profiling"
+}
+
+void
+Profiler::recordPaint(Kind kind, int element, const QWidget *widget, qint64 start)
+{
+    const qint64 ns = now() - start;
+    const PaintKey key((qint64(kind) << 32) | quint32(element), widget ? widget->metaObject()->className() : 0);
+    PaintStat &stat = gs_paintStats[key];
+    ++stat.calls;
+    stat.total += ns;
+    if (ns > stat.max)
+        stat.max = ns;
+    int bucket = 0;
+    for (qint64 us = ns/1000; us && bucket < N_BUCKETS - 1; us >>= 1)
+        ++bucket;
+    ++stat.histogram[bucket];
+
+    if (gs_dumpRequested) {
+        gs_dumpRequested = 0;
+        dumpPaint();
+    }
+}
+
+static QByteArray
+elementName(int kind, int element)
+{
+    const char *key = 0;
+#if QT_VERSION >= 0x050500
+    if (kind == Profiler::Primitive)
+        key = QMetaEnum::fromType<QStyle::PrimitiveElement>().valueToKey(element);
+    else if (kind == Profiler::Control)
+        key = QMetaEnum::fromType<QStyle::ControlElement>().valueToKey(element);
+    else
+        key = QMetaEnum::fromType<QStyle::ComplexControl>().valueToKey(element);
+#endif
+    if (key)
+        return QByteArray(key);
+    static const char *prefix[3] = { "PE_", "CE_", "CC_" };
+    return QByteArray(prefix[kind]) + QByteArray::number(quint32(element), 16);
+}
+
+static FILE *
+openTarget(const QByteArray &target)
+{
+    FILE *out = stderr;
+    if (target != "1" && target != "stderr") {
+        if (!(out = fopen(target.constData(), "a")))
+            out = stderr;
+    }
+    return out;
+}
+
+static void
+closeTarget(FILE *out)
+{
+    fflush(out);
+    if (out != stderr)
+        fclose(out);
+}
+
+static bool
+moreExpensive(const QPair<PaintKey, PaintStat> &s1, const QPair<PaintKey, PaintStat> &s2)
+{
+    return s1.second.total > s2.second.total;
+}
+
+void
+Profiler::dumpPaint()
+{
+    if (gs_paintStats.isEmpty())
+        return;
+
+    FILE *out = openTarget(gs_paintTarget);
+
+    QList< QPair<PaintKey, PaintStat> > stats;
+    qint64 total = 0;
+    for (QHash<PaintKey, PaintStat>::const_iterator it = gs_paintStats.constBegin(),
+                                                    end = gs_paintStats.constEnd(); it != end; ++it) {
+        stats << qMakePair(it.key(), it.value());
+        total += it.value().total;
+    }
+    std::sort(stats.begin(), stats.end(), moreExpensive);
+
+    fprintf(out, "=== Virtuality paint profile: %s (%lld), %d entries, %.3f ms (inclusive) ===\n",
+                 qPrintable(QCoreApplication::applicationName()), (long long)QCoreApplication::applicationPid(),
+                 stats.count(), total/1e6);
+    fprintf(out, "%-32s %-32s %10s %12s %10s %10s %10s  histogram (from µs:count)\n",
+                 "element", "widget class", "calls", "total ms", "mean µs", "p95 µs", "max µs");
+    for (int i = 0; i < stats.count(); ++i) {
+        const PaintKey &key = stats.at(i).first;
+        const PaintStat &stat = stats.at(i).second;
+        quint64 count = 0;
+        int p95 = N_BUCKETS - 1;
+        QByteArray histogram;
+        for (int b = 0; b < N_BUCKETS; ++b) {
+            if (!stat.histogram[b])
+                continue;
+            count += stat.histogram[b];
+            if (p95 == N_BUCKETS - 1 && count*100 >= stat.calls*95)
+                p95 = b;
+            histogram += ' ' + QByteArray::number(b ? 1 << (b-1) : 0) + ':' + QByteArray::number(stat.histogram[b]);
+        }
+        fprintf(out, "%-32s %-32s %10llu %12.3f %10.1f %10d %10.1f %s\n",
+                     elementName(int(key.first >> 32), int(key.first & 0xffffffff)).constData(),
+                     key.second ? key.second : "(none)", (unsigned long long)stat.calls, stat.total/1e6,
+                     stat.total/(1e3*stat.calls), 1 << p95, stat.max/1e3, histogram.constData());
+    }
+    closeTarget(out);
+}
+
+int
+Profiler::mark()
+{
+    return gs_phases.count();
+}
+
+void
+Profiler::phase(const char *name, qint64 ns, int first)
+{
+    Phase p = { name, ns, first };
+    gs_phases << p;
+}
+
+// phases are recorded when they end, ie. nested ones before their parent
+static QList<int>
+directPhases(int first, int end)
+{
+    QList<int> phases;
+    for (int i = end - 1; i >= first; i = gs_phases.at(i).first - 1)
+        phases.prepend(i);
+    return phases;
+}
+
+static void
+printPhases(FILE *out, int first, int end, int depth)
+{
+    const QList<int> phases = directPhases(first, end);
+    for (int i = 0; i < phases.count(); ++i) {
+        const Phase &p = gs_phases.at(phases.at(i));
+        fprintf(out, "%*s%-*s %10.3f ms\n", 2*depth, "", 40 - 2*depth, p.name, p.ns/1e6);
+        printPhases(out, p.first, phases.at(i), depth + 1);
+    }
+}
+
+void
+Profiler::dumpStartup()
+{
+    if (gs_phases.isEmpty())
+        return;
+    FILE *out = openTarget(gs_startupTarget);
+    qint64 total = 0;
+    const QList<int> top = directPhases(0, gs_phases.count());
+    for (int i = 0; i < top.count(); ++i)
+        total += gs_phases.at(top.at(i)).ns;
+    fprintf(out, "=== Virtuality startup profile: %s (%lld), %.3f ms ===\n",
+                 qPrintable(QCoreApplication::applicationName()), (long long)QCoreApplication::applicationPid(), total/1e6);
+    printPhases(out, 0, gs_phases.count(), 0);
+    closeTarget(out);
+    gs_phases.clear();
+}
@@ -0,0 +1,76 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BE_PROFILER_H
+#define BE_PROFILER_H
+
+#include <QElapsedTimer>
+
+class QWidget;
+
+namespace BE {
+namespace Profiler {
+
+/**
+ * Paint cost instrumentation for the draw* dispatch.
+ * export VIRTUALITY_PAINT_PROFILE=1 (report to stderr) or =/some/file
+ * The report is written when the application quits or on SIGUSR1 (with the next paint)
+ * Times are inclusive, ie. a CE that paints some PE is accounted for both.
+ */
+enum Kind { Primitive = 0, Control, Complex };
+
+extern bool paintActive;
+
+void init();
+qint64 now();
+void recordPaint(Kind kind, int element, const QWidget *widget, qint64 start);
+void dumpPaint();
+
+/**
+ * Startup phases of the style construction.
+ * export VIRTUALITY_STARTUP_PROFILE=1 (report to stderr) or =/some/file
+ * Every construction reports its phases once it's done, nested phases are indented
+ * and included in their parent
+ */
+extern bool startupActive;
+
+// the number of phases recorded so far
+int mark();
+// first: mark() when the phase began, everything recorded since is nested into it
+void phase(const char *name, qint64 ns, int first);
+void dumpStartup();
+
+// remembers the mark() along the start, so PROFILE_PHASE knows what's nested
+class PhaseTimer : public QElapsedTimer
+{
+public:
+    PhaseTimer() : first(0) {}
+    void start() { QElapsedTimer::start(); first = mark(); }
+    int first;
+};
+
+}
+}
+
+#define PROFILE_PAINT_START const qint64 profileStart = BE::Profiler::paintActive ? BE::Profiler::now() : 0
+#define PROFILE_PAINT_STOP(_KIND_, _ELEM_) if (profileStart) BE::Profiler::recordPaint(BE::Profiler::_KIND_, _ELEM_, widget, profileStart)
+// records the time since the (PhaseTimer) _TIMER_ was started and restarts it for the next phase
+#define PROFILE_PHASE(_NAME_, _TIMER_) if (BE::Profiler::startupActive) { \
+    BE::Profiler::phase(_NAME_, _TIMER_.nsecsElapsed(), _TIMER_.first); _TIMER_.start(); }
+
+#endif // BE_PROFILER_H
@@ -18,12 +18,15 @@
 
 #include <QAbstractScrollArea>
 #include <QApplication>
+#include <QCache>
+#include <QEvent>
 #include <QScrollBar>
 #include <QTimer>
 #include <QtDebug>
 #include "draw.h"
 #include "animator/hover.h"
 #include "animator/hovercomplex.h"
+#include "animator/tab.h"
 
 #define MAX_STEPS Animator::Hover::maxSteps()
 
@@ -50,31 +53,11 @@ detectScrollAreaStates(const QWidget* slider)
     if (scrollWidget) {
         if (scrollWidget->hasFocus())
             gs_scrollAreaState |= HasFocus;
-        if (scrollWidget->underMouse()) {
-            if (scrollWidget->geometry().y() < -400000) { // khtmlview and some other widget set off a render dummy
-                gs_scrollAreaState |= Hovered;               // by -500000px, leading to a weird global position
-            } else {
-                QPoint tl = scrollWidget->mapToGlobal(QPoint(0,0));
-                QRegion scrollArea(tl.x(), tl.y(), scrollWidget->width(), scrollWidget->height());
-                QList<QAbstractScrollArea*> scrollChilds = scrollWidget->findChildren<QAbstractScrollArea*>();
-                for (int i = 0; i < scrollChilds.size(); ++i) {
-                    if (scrollChilds[i]->testAttribute(Qt::WA_TransparentForMouseEvents))
-                        continue;
-                    if (scrollChilds[i]->geometry().y() < -400000)
-                        continue; // see above ... D'OHHH
-                    int d = 0;
-                    if (QScrollBar *bar = scrollChilds[i]->verticalScrollBar())
-                        d += bar->maximum() - bar->minimum();
-                    if (QScrollBar *bar = scrollChilds[i]->horizontalScrollBar())
-                        d += bar->maximum() - bar->minimum();
-                    if (!d)
-                        continue;
-                    QPoint tl = scrollChilds[i]->mapToGlobal(QPoint(0,0));
-                    scrollArea -= QRegion(tl.x(), tl.y(), scrollChilds[i]->width(), scrollChilds[i]->height());
-                }
-                if (scrollArea.contains(QCursor::pos()))
-                    gs_scrollAreaState |= Hovered;
-            }
+        if (scrollWidget->geometry().y() < -400000) { // khtmlview and some other widget set off a render dummy
+            if (scrollWidget->underMouse())               // by -500000px, leading to a weird global position
+                gs_scrollAreaState |= Hovered;
+        } else if (Animator::Hover::hoversArea(scrollWidget)) { // event driven, no cursor query
+            gs_scrollAreaState |= Hovered;
         }
     } else {
         gs_scrollAreaState |= Hovered;
@@ -103,16 +86,53 @@ if (scrollbar->subControls & SC_ScrollBar##_E_)\
 static int complexStep, widgetStep;
 
 
-static QPixmap *scrollBgCache = 0;
+// what was painted on top of the cached background the last time
+typedef struct {
+    QRect rect, slider;
+    int state, activeControls, controls, widgetStep, areaState;
+    bool animated, atMinimum, atMaximum;
+} ScrollBarState;
+
+typedef struct {
+    QPixmap bg;
+    QPoint offset; // in window, the erased background depends on it
+    qint64 palette;
+    ScrollBarState last;
+} ScrollBgCache;
+
+// a few slots, so that side-by-side views can scroll at the same time
+static QCache<const QWidget*, ScrollBgCache> gs_scrollBgCache(8);
 static QTimer cacheCleaner;
-const static QWidget *cachedScroller = 0;
 static QPainter *cPainter = 0;
 
+// the slider-only repaint relies on the rest of the bar being in the backingstore, which is
+// not the case after it was hidden or moved
+class SliderTrailGuard : public QObject
+{
+protected:
+    bool eventFilter(QObject *o, QEvent *e)
+    {
+        switch (e->type()) {
+        case QEvent::Show:
+        case QEvent::Hide:
+        case QEvent::Move:
+            if (ScrollBgCache *bgCache = gs_scrollBgCache.object(static_cast<QWidget*>(o)))
+                bgCache->last.slider = QRect();
+            else
+                o->removeEventFilter(this); // the cache entry is gone
+            return false;
+        default:
+            return false;
+        }
+    }
+};
+static SliderTrailGuard gs_sliderTrailGuard;
+
 void
 Style::clearScrollbarCache()
 {
-    cacheCleaner.stop(); cachedScroller = 0L;
-    delete scrollBgCache; scrollBgCache = 0L;
+    cacheCleaner.stop();
+    gs_scrollBgCache.clear();
 }
 
 enum SA_Flags { WebKit = 1, ComboBox = 2 };
@@ -153,10 +173,10 @@ Style::drawScrollBar(const QStyleOptionComplex *option, QPainter *painter, const
 {
 
     ASSURE_OPTION(scrollbar, Slider);
-    SAVE_PAINTER(Pen|Brush|Alias);
+    SAVE_PAINTER(Pen|Brush|Alias|Clip);
 
     cPainter = painter;
-    bool useCache = false, needsPaint = true;
+    ScrollBgCache *bgCache = 0L;
     bool isWebKit = false; // ouchhh... needs some specials
     if (widget)
     {
@@ -194,31 +214,34 @@ Style::drawScrollBar(const QStyleOptionComplex *option, QPainter *painter, const
         {   /// default scrollbar ===============
             gs_scrollAreaState &= ~ComboDropDown;
 
-            if (option->state & State_Sunken)
-            {   /// use caching for sliding scrollers to gain speed
-                useCache = true;
-                if (widget != cachedScroller)
-                {   // update cache
-                    cachedScroller = widget;
-                    delete scrollBgCache; scrollBgCache = 0L;
-                }
-                if (!scrollBgCache || scrollBgCache->size() != RECT.size())
-                {   // we need a new cache pixmap
-                    cacheCleaner.disconnect();
-                    connect(&cacheCleaner, SIGNAL(timeout()), this, SLOT(clearScrollbarCache()));
-                    delete scrollBgCache;
-                    scrollBgCache = new QPixmap(RECT.size());
-                    cPainter = new QPainter(scrollBgCache);
-                }
-                else
-                    needsPaint = false;
+            /// use caching for dragged, wheeled and kinetic scrollers to gain speed
+            const QPoint windowOffset = widget->mapTo(widget->window(), QPoint(0,0));
+            bgCache = gs_scrollBgCache.object(widget);
+            if (bgCache && (bgCache->bg.size() != RECT.size() || bgCache->offset != windowOffset ||
+                            bgCache->palette != PAL.cacheKey()))
+            {   // outdated
+                gs_scrollBgCache.remove(widget);
+                bgCache = 0L;
             }
-            if (needsPaint)
-            {
+            if (!bgCache)
+            {   // we need a new cache pixmap
+                bgCache = new ScrollBgCache;
+                bgCache->bg = QPixmap(RECT.size());
+                bgCache->offset = windowOffset;
+                bgCache->palette = PAL.cacheKey();
+                memset(&bgCache->last, 0, sizeof(ScrollBarState));
+                cPainter = new QPainter(&bgCache->bg);
                 QPoint offset(0,0);
                 if (isWebKit && (option->state & QStyle::State_Horizontal))
                     offset.setY(RECT.height() - widget->height());
                 erase(option, cPainter, widget, &offset);
+                cacheCleaner.disconnect();
+                connect(&cacheCleaner, SIGNAL(timeout()), this, SLOT(clearScrollbarCache()));
+                // the widget pointer is the key, don't let a successor run into the old bg
+                connect(widget, SIGNAL(destroyed()), this, SLOT(clearScrollbarCache()), Qt::UniqueConnection);
+                gs_scrollBgCache.insert(widget, bgCache);
+                const_cast<QWidget*>(widget)->removeEventFilter(&gs_sliderTrailGuard);
+                const_cast<QWidget*>(widget)->installEventFilter(&gs_sliderTrailGuard);
             }
         }
     }
@@ -256,9 +279,30 @@ Style::drawScrollBar(const QStyleOptionComplex *option, QPainter *painter, const
         { cPainter->end(); delete cPainter; cPainter = painter; }
 
     /// Background and groove have been painted
-    if (useCache) //flush the cache
-    {   cacheCleaner.start(1000);
-        painter->drawPixmap(RECT.topLeft(), *scrollBgCache);
+    if (bgCache) //flush the cache
+    {
+        ScrollBarState now;
+        memset(&now, 0, sizeof(ScrollBarState));
+        now.slider = QRect(); // compared as such below
+        now.rect = RECT; now.state = int(saveFlags); now.controls = int(scrollbar->subControls);
+        now.activeControls = int(scrollbar->activeSubControls); now.widgetStep = widgetStep;
+        now.areaState = gs_scrollAreaState; now.animated = (info != 0L);
+        now.atMinimum = scrollbar->sliderValue <= scrollbar->minimum;
+        now.atMaximum = scrollbar->sliderValue >= scrollbar->maximum;
+        const QRect oldSlider = bgCache->last.slider;
+        bgCache->last.slider = QRect();
+        // a tab transition renders into a pixmap, there's nothing to rely on - and the backingstore
+        // still has the old slider afterwards
+        const bool grabbing = Animator::Tab::isGrabbing();
+        const bool onlySliderMoved = !(info || grabbing) && oldSlider.isValid() && !memcmp(&now, &bgCache->last, sizeof(ScrollBarState));
+        now.slider = grabbing ? QRect() : subControlRect(CC_ScrollBar, scrollbar, SC_ScrollBarSlider, widget);
+        bgCache->last = now;
+        if (onlySliderMoved && oldSlider != now.slider)
+        {   // the rest is still in the backingstore (WA_OpaquePaintEvent), only fix the slider trail
+            painter->setClipRegion(QRegion(oldSlider).united(now.slider), Qt::IntersectClip);
+        }
+        cacheCleaner.start(1000);
+        painter->drawPixmap(RECT.topLeft(), bgCache->bg);
     }
 
     if (config.slider.buttons)
@@ -309,7 +353,7 @@ Style::drawScrollBarButton(const QStyleOption *option, QPainter *painter, const
         OPT_HOVER
 
         painter->setPen(Qt::NoPen);
-        painter->setBrush(hover ? FCOLOR(Text) : FX::blend(FCOLOR(Base), FCOLOR(Text)));
+        painter->setBrush(hover ? FCOLOR(Text) : DERIVED(baseMid));
 //         const int dx = RECT.width()/4, dy = RECT.height()/4;
 //         QRect rect = RECT.adjusted(dx, dy, -dx, -dy);
         drawArrow(dir, RECT, painter);
@@ -16,10 +16,13 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <QCache>
 #include <QEvent>
+#include <QHash>
 #include <QImage>
-#include <QPainter>
 #include <QPixmap>
+#include <QVector>
+#include <QWidget>
 
 #ifdef BE_WS_X11
 #if QT_VERSION >= 0x060200
@@ -30,6 +33,9 @@
 #endif
 #include "fixx11h.h"
 #include <QtDebug>
+#include <QtEndian>
+
+#include <cmath>
 
 #include "FX.h"
 #include "shadows.h"
@@ -38,6 +44,12 @@ using namespace BE;
 
 #ifdef BE_WS_X11
 #include "xproperty.h"
+#if QT_VERSION >= 0x050000
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <xcb/xcb.h>
+#include <xcb/shm.h>
+#endif
 #include "fixx11h.h"
 class ShadowManager : public QObject {
 public:
@@ -57,180 +69,354 @@ static ShadowManager *shadowManager = 0;
 static uint size[2] = { 12, 64 };
 static QColor color(0,0,0,0);
 static bool halo(false);
+static int roundness(8);
 
 static Pixmap (*pixmaps[2])[8] = {0,0};
+static quint64 pixmapKeys[2] = {0,0};
 static unsigned long globalShadowData[2][12];
+static bool storedToRoot[2] = {false,false};
+static QHash<WId, int> shadowed; // the windows we set our shadows on and their Type
 #endif
 
-static Pixmap nativePixmap(const QImage qtImg)
-{
 #ifdef BE_WS_X11
-    if (qtImg.isNull())
-        return 0;
+/**
+ * Copies the tile into the upload buffer and blends the dither on top in the same pass
+ * (SourceOver, on complete dither blocks only - like the painter used to)
+ * swap converts to the servers byte order, Xlib does that itself.
+ */
+static void
+stage(const QImage &tile, const QImage &dither, quint32 *dst, bool swap)
+{
+    const int dw = dither.width(), dh = dither.height();
+    const int w = tile.width(), h = tile.height();
+    const int dx = w > dw ? dw*((w-1)/dw) : 0;
+    const int dy = h > dh ? dh*((h-1)/dh) : 0;
+    for (int y = 0; y < h; ++y) {
+        const QRgb *src = reinterpret_cast<const QRgb*>(tile.constScanLine(y));
+        const QRgb *noise = reinterpret_cast<const QRgb*>(dither.constScanLine(y % dh));
+        for (int x = 0; x < w; ++x) {
+            QRgb px = src[x];
+            if (x < dx && y < dy) {
+                const QRgb d = noise[x % dw];
+                const int ia = 255 - qAlpha(d);
+                px = qRgba(qRed(d) + qRed(px)*ia/255, qGreen(d) + qGreen(px)*ia/255,
+                           qBlue(d) + qBlue(px)*ia/255, qAlpha(d) + qAlpha(px)*ia/255);
+            }
+            *dst++ = swap ? qbswap<quint32>(px) : px;
+        }
+    }
+}
 
+/**
+ * Uploads count premultiplied ARGB32 tiles into new depth 32 pixmaps (store)
+ * One buffer for all, through a MIT-SHM segment if the server can attach it (ie. is local)
+ * and pipelined PutImage requests otherwise. One GC for all pixmaps.
+ */
+static void
+nativePixmaps(const QImage *tiles, int count, Pixmap *store)
+{
     static QImage dither;
     if (dither.isNull())
-        dither = FX::newDitherImage();
-    QPainter pd(const_cast<QImage*>(&qtImg));
-    for (int x = 0; x < qtImg.width() - dither.width(); x += dither.width()) {
-        for (int y = 0; y < qtImg.height() - dither.height(); y += dither.height()) {
-            pd.drawImage(x, y, dither);
+        dither = FX::newDitherImage().convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    QVector<int> offset(count + 1); // in bytes
+    offset[0] = 0;
+    for (int i = 0; i < count; ++i)
+        offset[i+1] = offset[i] + 4*tiles[i].width()*tiles[i].height();
+    const int bytes = offset[count];
+    QByteArray local;
+    uchar *buffer = 0;
+
+#if QT_VERSION >= 0x050000
+    xcb_connection_t *c = BE_XCB_CONN;
+    const bool swap = (xcb_get_setup(c)->image_byte_order == XCB_IMAGE_ORDER_MSB_FIRST) != (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+
+    xcb_shm_seg_t segment = 0;
+    const xcb_query_extension_reply_t *shm = xcb_get_extension_data(c, &xcb_shm_id);
+    if (shm && shm->present) {
+        const int id = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0600);
+        if (id != -1) {
+            void *addr = shmat(id, 0, 0);
+            if (addr != (void*)-1) {
+                segment = xcb_generate_id(c);
+                // fails for remote servers - the only round trip unless we've to wait for the server below
+                if (xcb_generic_error_t *error = xcb_request_check(c, xcb_shm_attach_checked(c, segment, id, true))) {
+                    free(error);
+                    shmdt(addr);
+                    segment = 0;
+                } else {
+                    buffer = static_cast<uchar*>(addr);
+                }
+            }
+            shmctl(id, IPC_RMID, 0); // released once both sides detached
         }
     }
-    pd.end();
-
-    XImage ximage;
-    ximage.width            = qtImg.width();
-    ximage.height           = qtImg.height();
-    ximage.xoffset          = 0;
-    ximage.format           = ZPixmap;
-    // This is a hack to prevent the image data from detaching
-    ximage.data             = (char*) const_cast<const QImage*>(&qtImg)->bits();
+    if (!buffer) {
+        local.resize(bytes);
+        buffer = reinterpret_cast<uchar*>(local.data());
+    }
+    for (int i = 0; i < count; ++i)
+        stage(tiles[i], dither, reinterpret_cast<quint32*>(buffer + offset[i]), swap);
+
+    const xcb_window_t root = BE_X11_ROOT;
+    xcb_gcontext_t gc = 0;
+    for (int i = 0; i < count; ++i) {
+        const int w = tiles[i].width(), h = tiles[i].height();
+        const xcb_pixmap_t pix = xcb_generate_id(c);
+        xcb_create_pixmap(c, 32, pix, root, w, h);
+        if (!gc) {
+            gc = xcb_generate_id(c);
+            xcb_create_gc(c, gc, pix, 0, 0);
+        }
+        if (segment)
+            xcb_shm_put_image(c, pix, gc, w, h, 0, 0, w, h, 0, 0, 32, XCB_IMAGE_FORMAT_Z_PIXMAP, 0, segment, offset[i]);
+        else // at most 72x72x4 bytes, way below the request limit
+            xcb_put_image(c, XCB_IMAGE_FORMAT_Z_PIXMAP, pix, gc, w, h, 0, 0, 0, 32, offset[i+1] - offset[i], buffer + offset[i]);
+        store[i] = pix;
+    }
+    if (gc)
+        xcb_free_gc(c, gc);
+    if (segment) {
+        xcb_shm_detach(c, segment);
+        // the server has to be done with the segment before it's gone
+        free(xcb_get_input_focus_reply(c, xcb_get_input_focus(c), 0));
+        shmdt(buffer);
+    } else {
+        xcb_flush(c);
+    }
+#else
+    local.resize(bytes);
+    buffer = reinterpret_cast<uchar*>(local.data());
+    for (int i = 0; i < count; ++i)
+        stage(tiles[i], dither, reinterpret_cast<quint32*>(buffer + offset[i]), false);
+
+    GC context = 0;
+    for (int i = 0; i < count; ++i) {
+        XImage ximage;
+        ximage.width            = tiles[i].width();
+        ximage.height           = tiles[i].height();
+        ximage.xoffset          = 0;
+        ximage.format           = ZPixmap;
+        ximage.data             = reinterpret_cast<char*>(buffer + offset[i]);
 #if Q_BYTE_ORDER == Q_BIG_ENDIAN
-    ximage.byte_order       = MSBFirst;
+        ximage.byte_order       = MSBFirst;
 #else
-    ximage.byte_order       = LSBFirst;
+        ximage.byte_order       = LSBFirst;
 #endif
-    ximage.bitmap_unit      = 32;
-    ximage.bitmap_bit_order = ximage.byte_order;
-    ximage.bitmap_pad       = 32;
-    ximage.depth            = 32;
-    ximage.bytes_per_line   = qtImg.bytesPerLine();
-    ximage.bits_per_pixel   = 32;
-    ximage.red_mask     = 0x00ff0000;
-    ximage.green_mask   = 0x0000ff00;
-    ximage.blue_mask    = 0x000000ff;
-    ximage.obdata           = 0;
-    if (!XInitImage(&ximage)) {
-        qDebug() << "error on init ximage";
+        ximage.bitmap_unit      = 32;
+        ximage.bitmap_bit_order = ximage.byte_order;
+        ximage.bitmap_pad       = 32;
+        ximage.depth            = 32;
+        ximage.bytes_per_line   = 4*ximage.width;
+        ximage.bits_per_pixel   = 32;
+        ximage.red_mask     = 0x00ff0000;
+        ximage.green_mask   = 0x0000ff00;
+        ximage.blue_mask    = 0x000000ff;
+        ximage.obdata           = 0;
+        if (!XInitImage(&ximage)) {
+            qDebug() << "error on init ximage";
+        }
+        store[i] = XCreatePixmap(BE_X11_DISPLAY, DefaultRootWindow(BE_X11_DISPLAY), ximage.width, ximage.height, 32);
+        if (!context)
+            context = XCreateGC(BE_X11_DISPLAY, store[i], 0, NULL);
+        XPutImage(BE_X11_DISPLAY, store[i], context, &ximage, 0, 0, 0, 0, ximage.width, ximage.height);
     }
-
-    Pixmap xPix = XCreatePixmap(BE_X11_DISPLAY, DefaultRootWindow(BE_X11_DISPLAY), qtImg.width(), qtImg.height(), 32);
-    GC context = XCreateGC(BE_X11_DISPLAY, xPix, 0, NULL);
-    XPutImage(BE_X11_DISPLAY, xPix, context, &ximage, 0, 0, 0, 0, qtImg.width(), qtImg.height());
-    XFreeGC(BE_X11_DISPLAY, context);
-    return xPix;
-#else
-    return 0; // just for GCC - makes no sense at all anyway
+    if (context)
+        XFreeGC(BE_X11_DISPLAY, context);
 #endif
 }
+#endif
 
-static void tile(const QImage &src, QImage &dst, bool h)
+#ifdef BE_WS_X11
+// top, right, bottom, left - how far the shadow reaches beyond the window
+static void
+paddings(int sz, bool halo, unsigned long *pad)
 {
-    const QRgb* srcPixel = (const QRgb*)src.constBits();
-    QRgb* dstPixel = (QRgb*)dst.bits();
-    if (h) {
-        for (int i = 0; i < dst.width(); ++i)
-        for (int j = 0; j < src.height(); ++j)
-            dstPixel[dst.width()*j + i] = srcPixel[j];
+    if (halo) {
+        pad[0] = pad[1] = pad[2] = pad[3] = 3*(sz-4)/4;
     } else {
-        for (int i = 0; i < dst.height(); ++i)
-        for (int j = 0; j < src.width(); ++j)
-            dstPixel[src.width()*i + j] = srcPixel[j];
+        pad[0] = (sz-4)/2;
+        pad[1] = 2*(sz-4)/3;
+        pad[2] = sz-4;
+        pad[3] = 2*(sz-4)/3;
     }
 }
 
+static quint64
+tileKey(int sz, const QColor &c, bool halo, int roundness)
+{
+    return (quint64(sz & 0xfff) << 41) | (quint64(roundness & 0xff) << 33) | (quint64(halo) << 32) | c.rgb();
+}
+
+typedef struct {
+    QImage tile[8];
+} ShadowTiles;
+static QCache<quint64, ShadowTiles> gs_tiles(1024); // KiB
+
+// a box of 2*h blurred with sigma, sampled at pixel centers around the center pixel sz
+static void
+boxProfile(float *profile, int sz, float h, float sigma)
+{
+    const float s = 1.0f/(sigma*float(M_SQRT2));
+    const float peak = erff(h*s);
+    for (int i = 0; i <= 2*sz; ++i) {
+        const float d = i - sz;
+        profile[i] = 0.5f*(erff((d + h)*s) - erff((d - h)*s))/peak;
+    }
+}
+
+/**
+ * The 8 tiles of a (2*sz+1)² shadow in _KDE_NET_WM_SHADOW order (top, top right, right ... top left)
+ * A blurred box is separable (the difference of two erf), so every pixel is peak*p[x]*p[y] - no
+ * gradients to rasterize. The window area is cut out with an analytically antialiased rounded
+ * rect and the edge tiles repeat the center row/column, so the tiles are written directly.
+ */
+static const ShadowTiles *
+shadowTiles(int sz, const QColor &c, bool halo, int roundness)
+{
+    const quint64 key = tileKey(sz, c, halo, roundness);
+    if (const ShadowTiles *tiles = gs_tiles.object(key))
+        return tiles;
+
+    const int n = 2*sz + 1;
+    const float focus = halo ? 9.0f : 5.0f;
+    // what the three stacked gradients added up to in the center
+    const int weaken = halo ? 0 : sz/2;
+    const float alpha = 1.0f - (1.0f - qMax(0, 96-weaken)/255.0f)*(1.0f - qMax(0, 80-weaken)/255.0f)*
+                               (1.0f - qMax(0, 64-weaken)/255.0f);
+    QVector<float> profile(n), glow(n);
+    boxProfile(profile.data(), sz, focus, qMax(1.0f, (sz - focus)/3.0f));
+    const float glowAlpha = halo ? qMax(0, 192 - sz)/255.0f : 0.0f;
+    if (halo)
+        boxProfile(glow.data(), sz, focus, qMax(1.0f, (sz - focus)/6.0f));
+
+    // the window
+    unsigned long pad[4];
+    paddings(sz, halo, pad);
+    const float left = pad[3] + 1, right = n - float(pad[1] + 1);
+    const float top = pad[0] + 1, bottom = n - float(pad[2] + 1);
+    const float cx = 0.5f*(left + right), cy = 0.5f*(top + bottom);
+    const float r = qMin(float(roundness), 0.5f*qMin(right - left, bottom - top));
+    const float hw = 0.5f*(right - left) - r, hh = 0.5f*(bottom - top) - r;
+
+    const int tw[8] = { 32, sz, sz, sz, 32, sz, sz, sz };
+    const int th[8] = { sz, sz, 32, sz, sz, sz, 32, sz };
+    // where the tile starts in the full shadow, -1 repeats the center row/column
+    const int ox[8] = { -1, sz+1, sz+1, sz+1, -1, 0, 0, 0 };
+    const int oy[8] = { 0, 0, -1, sz+1, sz+1, sz+1, -1, 0 };
+
+    ShadowTiles *tiles = new ShadowTiles;
+    int cost = 0;
+    for (int t = 0; t < 8; ++t) {
+        QImage &img = tiles->tile[t];
+        img = QImage(tw[t], th[t], QImage::Format_ARGB32_Premultiplied);
+        for (int j = 0; j < th[t]; ++j) {
+            const int y = oy[t] < 0 ? sz : oy[t] + j;
+            QRgb *line = reinterpret_cast<QRgb*>(img.scanLine(j));
+            for (int i = 0; i < tw[t]; ++i) {
+                const int x = ox[t] < 0 ? sz : ox[t] + i;
+                // signed distance to the rounded window rect -> coverage
+                const float qx = qAbs(x + 0.5f - cx) - hw, qy = qAbs(y + 0.5f - cy) - hh;
+                const float ex = qMax(qx, 0.0f), ey = qMax(qy, 0.0f);
+                const float sd = sqrtf(ex*ex + ey*ey) + qMin(qMax(qx, qy), 0.0f) - r;
+                const float uncovered = qBound(0.0f, 0.5f + sd, 1.0f);
+                const float a = alpha*profile[x]*profile[y]*uncovered;
+                const float g = glowAlpha ? glowAlpha*glow[x]*glow[y]*uncovered*(1.0f - a) : 0.0f;
+                // shadow over the white glow, premultiplied
+                line[i] = qRgba(qRound(a*c.red() + g*255), qRound(a*c.green() + g*255),
+                                qRound(a*c.blue() + g*255), qRound((a + g)*255));
+            }
+        }
+        cost += img.bytesPerLine()*img.height();
+    }
+    gs_tiles.insert(key, tiles, qMax(1, cost/1024));
+    return tiles;
+}
+#endif
+
+#ifdef BE_WS_X11
+// sets our current shadows again on the windows that have the Type (or any for None)
+static void
+resetShadows(int type)
+{
+    for (QHash<WId, int>::iterator it = shadowed.begin(); it != shadowed.end();) {
+        const QWidget *w = QWidget::find(it.key());
+        if (!(w && w->internalWinId() == it.key())) { // gone
+            it = shadowed.erase(it);
+            continue;
+        }
+        if ((type == Shadows::None || it.value() == type) && pixmaps[it.value()-1])
+            XProperty::set(it.key(), XProperty::kwinShadow, globalShadowData[it.value()-1], XProperty::LONG, 12);
+        ++it;
+    }
+}
+
+// (re)creates the pixmaps of both sizes as one upload, unless they're still valid
+static void
+createPixmaps()
+{
+    QImage tiles[16];
+    Pixmap store[16];
+    int count = 0;
+    Pixmap (*outdated[2])[8] = { 0L, 0L };
+    bool missing[2] = { false, false };
+    for (int t = 0; t < 2; ++t) {
+        const quint64 key = tileKey(size[t], color, halo, roundness);
+        if (pixmaps[t] && pixmapKeys[t] == key)
+            continue;
+        outdated[t] = pixmaps[t]; // size, color etc. changed
+        pixmaps[t] = 0L;
+        pixmapKeys[t] = key;
+        missing[t] = true;
+        // copies, the cache may drop them when inserting the other size
+        const ShadowTiles *shadow = shadowTiles(size[t], color, halo, roundness);
+        for (int i = 0; i < 8; ++i)
+            tiles[count++] = shadow->tile[i];
+    }
+    if (!count)
+        return;
+    nativePixmaps(tiles, count, store);
+    count = 0;
+    for (int t = 0; t < 2; ++t) {
+        if (!missing[t])
+            continue;
+        Pixmap *pix = new Pixmap[8];
+        for (int i = 0; i < 8; ++i)
+            globalShadowData[t][i] = pix[i] = store[count++];
+        pixmaps[t] = (Pixmap (*)[8])pix;
+        paddings(size[t], halo, &globalShadowData[t][8]);
+        if (!outdated[t])
+            continue;
+        // move everything that still points to the old pixmaps over before they're gone
+        if (storedToRoot[t])
+            XProperty::set(DefaultRootWindow(BE_X11_DISPLAY), XProperty::bespinShadow[t], globalShadowData[t], XProperty::LONG, 12);
+        resetShadows(t + 1);
+        XProperty::flush();
+        for (int i = 0; i < 8; ++i)
+            XFreePixmap(BE_X11_DISPLAY, (*outdated[t])[i]);
+        delete [] outdated[t];
+    }
+}
+#endif
+
 static unsigned long*
 shadowData(Shadows::Type t, bool storeToRoot)
 {
 #ifdef BE_WS_X11
     XProperty::init();
     unsigned long _12 = 12;
-    unsigned long *data = XProperty::get<unsigned long>(DefaultRootWindow(BE_X11_DISPLAY), XProperty::bespinShadow[t-1], XProperty::LONG, &_12);
+    // if the root ones are our own, they might be outdated
+    unsigned long *data = storedToRoot[t-1] ? 0L :
+        XProperty::get<unsigned long>(DefaultRootWindow(BE_X11_DISPLAY), XProperty::bespinShadow[t-1], XProperty::LONG, &_12);
     if (!data)
     {
-        const int sz = size[t == Shadows::Large];
-        float focus = 5.0f/sz;
-        if (halo)
-        {
-            focus = 9.0f/sz;
-            globalShadowData[t-1][8] = globalShadowData[t-1][9] = // yes, next line
-            globalShadowData[t-1][10] = globalShadowData[t-1][11] = 3*(sz-4)/4;
-        }
-        else
-        {
-            focus = 5.0f/sz;
-            globalShadowData[t-1][8] = (sz-4)/2;
-            globalShadowData[t-1][9] = 2*(sz-4)/3;
-            globalShadowData[t-1][10] = sz-4;
-            globalShadowData[t-1][11] = 2*(sz-4)/3;
-        }
-
-        if (!pixmaps[t-1])
-        {
-            Pixmap *store = new Pixmap[8];
-            pixmaps[t-1] = (Pixmap (*)[8])store;
-
-            // radial gradient requires the raster engine anyway and we need *working* ... -> QImage
-            QImage shadow(2*sz+1, 2*sz+1, QImage::Format_ARGB32);
-            shadow.fill(Qt::transparent);
-            QRadialGradient rg(QPoint(sz+1,sz+1),sz);
-            const QRect shadowRect(shadow.rect());
-            QPainter p(&shadow);
-            p.setPen(Qt::NoPen);
-
-            int weaken = sz/2;
-            if (halo)
-            {
-                weaken = 0;
-                rg.setColorAt(focus, QColor(255,255,255,192-sz)); rg.setColorAt(focus + (1.0f-focus)/2.0f, QColor(255,255,255,0));
-                p.setBrush(rg);
-                p.drawRect(shadowRect);
-            }
-
-            QColor transparent = color; transparent.setAlpha(0);
-            color.setAlpha(96-weaken);
-            rg.setColorAt(focus, color); rg.setColorAt(0.98, transparent);
-            p.setBrush(rg);
-            p.drawRect(shadowRect);
-
-            rg.setStops(QGradientStops());
-
-            color.setAlpha(80-weaken);
-            rg.setColorAt(focus, color); rg.setColorAt(focus + (1.0f-focus)/1.25f, transparent);
-            p.setBrush(rg);
-            p.drawRect(shadowRect);
-
-            rg.setStops(QGradientStops());
-
-            color.setAlpha(64-weaken);
-            rg.setColorAt(focus, color); rg.setColorAt(focus + (1.0f-focus)/1.52f, transparent);
-            p.setBrush(rg);
-            p.drawRect(shadowRect);
-
-            p.setCompositionMode(QPainter::CompositionMode_DestinationIn);
-            p.setRenderHint(QPainter::Antialiasing);
-            p.setBrush(Qt::transparent);
-            p.drawRoundedRect(shadow.rect().adjusted(globalShadowData[t-1][9]+1, globalShadowData[t-1][8]+1,
-                                                     -(1+globalShadowData[t-1][11]), -(1+globalShadowData[t-1][10])), 8,8);
-
-            p.end();
-
-            QImage vc(sz, 32, QImage::Format_ARGB32);
-            QImage hc(32, sz, QImage::Format_ARGB32);
-            QImage buffer = shadow.copy(sz,0,1,sz); // TopMid
-            tile(buffer, hc, true);
-            store[0] = nativePixmap(hc);
-            store[1] = nativePixmap(shadow.copy(sz+1,0,sz,sz)); // TopRight
-            buffer = shadow.copy(sz+1,sz,sz,1); // MidRight
-            tile(buffer, vc, false);
-            store[2] = nativePixmap(vc);
-            store[3] = nativePixmap(shadow.copy(sz+1,sz+1,sz,sz)); // BtmRight
-            buffer = shadow.copy(sz,sz+1,1,sz); // BtmMid
-            tile(buffer, hc, true);
-            store[4] = nativePixmap(hc);
-            store[5] = nativePixmap(shadow.copy(0,sz+1,sz,sz)); // BtmLeft
-            buffer = shadow.copy(0,sz,sz,1); // MidLeft
-            tile(buffer, vc, false);
-            store[6] = nativePixmap(vc);
-            store[7] = nativePixmap(shadow.copy(0,0,sz,sz)); // TopLeft
-        }
-        for (int i = 0; i < 8; ++i)
-            globalShadowData[t-1][i] = (*pixmaps[t-1])[i];
-
+        createPixmaps();
         data = &globalShadowData[t-1][0];
-        if (storeToRoot)
+        if (storeToRoot && !storedToRoot[t-1])
+        {
             XProperty::set(DefaultRootWindow(BE_X11_DISPLAY), XProperty::bespinShadow[t-1], data, XProperty::LONG, 12);
+            storedToRoot[t-1] = true;
+        }
     }
     return data;
 #else
@@ -265,7 +451,9 @@ Shadows::cleanUp()
             delete [] pixmaps[i];
             pixmaps[i] = 0L;
         }
+        storedToRoot[i] = false;
     }
+    shadowed.clear();
 #endif
 }
 
@@ -282,6 +470,15 @@ Shadows::manage(QWidget *w)
 #endif
 }
 
+void
+Shadows::refresh()
+{
+#ifdef BE_WS_X11
+    if (BE::isPlatformX11()) // TODO: port XProperty for wayland
+        resetShadows(Shadows::None);
+#endif
+}
+
 void
 Shadows::set(WId id, Shadows::Type t, bool storeToRoot)
 {
@@ -297,10 +494,19 @@ Shadows::set(WId id, Shadows::Type t, bool storeToRoot)
     {
     case Shadows::None:
         XProperty::remove(id, XProperty::kwinShadow);
+        shadowed.remove(id);
         break;
     case Shadows::Large:
     case Shadows::Small:
-        XProperty::set(id, XProperty::kwinShadow, shadowData(t, storeToRoot), XProperty::LONG, 12);
+    {
+        unsigned long *data = shadowData(t, storeToRoot);
+        XProperty::set(id, XProperty::kwinShadow, data, XProperty::LONG, 12);
+        if (data == &globalShadowData[t-1][0])
+            shadowed.insert(id, t);
+        else // someone else's from the root window
+            XFree(data);
+        break;
+    }
     default:
         break;
     }
@@ -321,6 +527,14 @@ void Shadows::setHalo(bool h)
 #endif
 }
 
+void
+Shadows::setRoundness(int r)
+{
+#ifdef BE_WS_X11
+    roundness = qMin(64, qMax(0, r));
+#endif
+}
+
 void
 Shadows::setSize(int small, int big)
 {
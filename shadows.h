@@ -27,9 +27,12 @@ namespace Shadows {
     BLIB_EXPORT bool areSet(WId id);
     BLIB_EXPORT void cleanUp();
     BLIB_EXPORT void manage(QWidget *w);
+    // sets the shadows again on every window we put them on (eg. for a new compositor)
+    BLIB_EXPORT void refresh();
     BLIB_EXPORT void set(WId id, Shadows::Type t, bool storeToRoot = false);
     BLIB_EXPORT void setColor(QColor c);
     BLIB_EXPORT void setHalo(bool halo);
+    BLIB_EXPORT void setRoundness(int r);
     BLIB_EXPORT void setSize(int small, int big);
 } }
 
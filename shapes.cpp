@@ -16,6 +16,10 @@
  *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  */
 
+#include <QCache>
+#include <QColor>
+#include <QImage>
+#include <QPainter>
 #include <QPainterPath>
 #include <QRectF>
 #include "shapes.h"
@@ -601,3 +605,104 @@ Shapes::logo(const QRectF &bound)
     path.addEllipse(bound.right() - 3*s8, bound.y(), s4, s4);
     return path;
 }
+
+static QPainterPath
+build(Shapes::Shape shape, const QRectF &bound, Shapes::Style style)
+{
+    switch (shape)
+    {
+    case Shapes::Close: return Shapes::close(bound, style);
+    case Shapes::Min: return Shapes::min(bound, style);
+    case Shapes::Max: return Shapes::max(bound, style);
+    case Shapes::DockControl: return Shapes::dockControl(bound, false, style);
+    case Shapes::FloatingDockControl: return Shapes::dockControl(bound, true, style);
+    case Shapes::Restore: return Shapes::restore(bound, style);
+    case Shapes::Stick: return Shapes::stick(bound, style);
+    case Shapes::Unstick: return Shapes::unstick(bound, style);
+    case Shapes::KeepAbove: return Shapes::keepAbove(bound, style);
+    case Shapes::KeepBelow: return Shapes::keepBelow(bound, style);
+    case Shapes::UnAboveBelow: return Shapes::unAboveBelow(bound, style);
+    case Shapes::Menu: return Shapes::menu(bound, false, style);
+    case Shapes::LeftMenu: return Shapes::menu(bound, true, style);
+    case Shapes::Help: return Shapes::help(bound, style);
+    case Shapes::Shade: return Shapes::shade(bound, style);
+    case Shapes::Unshade: return Shapes::unshade(bound, style);
+    case Shapes::Exposee: return Shapes::exposee(bound, style);
+    case Shapes::Info: return Shapes::info(bound, style);
+    case Shapes::Logo: return Shapes::logo(bound);
+    }
+    return QPainterPath();
+}
+
+// shape:8 | style:8 | dpr:8 | width:20 | height:20, dpr and sizes in 1/16 - the paths are float anyway
+static quint64
+cacheKey(Shapes::Shape shape, Shapes::Style style, double w, double h, double dpr = 1.0)
+{
+    return (quint64(shape & 0xff) << 56) | (quint64(style & 0xff) << 48) |
+           (quint64(qRound(dpr*16.0) & 0xff) << 40) |
+           (quint64(qRound(w*16.0) & 0xfffff) << 20) | quint64(qRound(h*16.0) & 0xfffff);
+}
+
+// paths are few and cheap to keep, masks are accounted in KiB
+static QCache<quint64, QPainterPath> gs_paths(256);
+static QCache<quint64, QImage> gs_masks(1024);
+
+QPainterPath
+Shapes::path(Shape shape, const QRectF &bound, Style style)
+{
+    const quint64 key = cacheKey(shape, style, bound.width(), bound.height());
+    QPainterPath *path = gs_paths.object(key);
+    if (!path) {
+        path = new QPainterPath(build(shape, QRectF(QPointF(0,0), bound.size()), style));
+        gs_paths.insert(key, path);
+    }
+    if (bound.topLeft().isNull())
+        return *path;
+    return path->translated(bound.topLeft());
+}
+
+QImage
+Shapes::mask(Shape shape, const QSize &size, Style style, double dpr)
+{
+    const quint64 key = cacheKey(shape, style, size.width(), size.height(), dpr);
+    if (QImage *img = gs_masks.object(key))
+        return *img;
+
+    QImage img(size*dpr, QImage::Format_ARGB32_Premultiplied);
+    img.fill(Qt::transparent);
+    QPainter p(&img);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setPen(Qt::NoPen);
+    p.setBrush(Qt::black);
+    p.scale(dpr, dpr);
+    p.drawPath(path(shape, QRectF(0, 0, size.width(), size.height()), style));
+    p.end();
+#if QT_VERSION >= 0x050000
+    img.setDevicePixelRatio(dpr);
+#endif
+#if QT_VERSION >= 0x050a00
+    const int cost = int(img.sizeInBytes()/1024);
+#else
+    const int cost = img.byteCount()/1024;
+#endif
+    gs_masks.insert(key, new QImage(img), qMax(1, cost));
+    return img;
+}
+
+QImage
+Shapes::tinted(Shape shape, const QSize &size, const QColor &color, Style style, double dpr)
+{
+    QImage img = mask(shape, size, style, dpr);
+    QPainter p(&img); // detaches from the cached mask
+    p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    p.fillRect(QRect(QPoint(0,0), img.size()), color);
+    p.end();
+    return img;
+}
+
+void
+Shapes::clearCache()
+{
+    gs_paths.clear();
+    gs_masks.clear();
+}
@@ -19,8 +19,11 @@
 #ifndef PATHS_H
 #define PATHS_H
 
+class QColor;
+class QImage;
 class QPainterPath;
 class QRectF;
+class QSize;
 
 namespace BE
 {
@@ -44,6 +47,20 @@ namespace Shapes
     BLIB_EXPORT QPainterPath exposee(const QRectF &bound, Style style = Round);
     BLIB_EXPORT QPainterPath info(const QRectF &bound, Style style = Round);
     BLIB_EXPORT QPainterPath logo(const QRectF &bound);
+
+    /**
+     * Cached variants of the above - the paths are built once per (shape, style, bound size)
+     * and shared afterwards, the bound position is applied by translation.
+     * mask() rasterizes the path into an antialiased alpha mask (opaque black) which tinted()
+     * colorizes, so repeated glyphs in different colors don't need to hit the rasterizer at all
+     */
+    enum Shape { Close = 0, Min, Max, DockControl, FloatingDockControl, Restore, Stick, Unstick,
+                 KeepAbove, KeepBelow, UnAboveBelow, Menu, LeftMenu, Help, Shade, Unshade,
+                 Exposee, Info, Logo };
+    BLIB_EXPORT QPainterPath path(Shape shape, const QRectF &bound, Style style = Round);
+    BLIB_EXPORT QImage mask(Shape shape, const QSize &size, Style style = Round, double dpr = 1.0);
+    BLIB_EXPORT QImage tinted(Shape shape, const QSize &size, const QColor &color, Style style = Round, double dpr = 1.0);
+    BLIB_EXPORT void clearCache();
 }
 }
 #endif // PATHS_H
@@ -0,0 +1,186 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLibraryInfo>
+#include <QSettings>
+#include <QStringList>
+#include <cstring>
+
+#include "config.defaults"
+#include "diskcache.h"
+#include "snapshot.h"
+
+using namespace BE;
+
+// bump when the Settings layout or the meaning of a field changes
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_KEY "settings"
+#define CONFIG_FILES 4
+
+typedef struct {
+    quint32 version, size;
+    qint64 stamp[CONFIG_FILES][2]; // mtime (ms), size - or -1 if the file does not exist
+} Header;
+
+/**
+ * The files QSettings("BE", "Style") is made of: the users one, the organization fallback
+ * and the system wide variants of both.
+ * Other platforms keep the settings in places we cannot cheaply watch, so there's no snapshot
+ */
+static bool
+configFiles(QString *files)
+{
+#if defined(Q_OS_UNIX) && !defined(Q_OS_MAC)
+    const QByteArray xdg = qgetenv("XDG_CONFIG_HOME");
+    const QString user = xdg.isEmpty() ? QDir::homePath() + "/.config" : QFile::decodeName(xdg);
+#if QT_VERSION >= 0x060000
+    const QString system = QLibraryInfo::path(QLibraryInfo::SettingsPath);
+#else
+    const QString system = QLibraryInfo::location(QLibraryInfo::SettingsPath);
+#endif
+    files[0] = user + "/BE/Style.conf";
+    files[1] = user + "/BE.conf";
+    files[2] = system + "/BE/Style.conf";
+    files[3] = system + "/BE.conf";
+    return true;
+#else
+    Q_UNUSED(files);
+    return false;
+#endif
+}
+
+static bool
+makeHeader(Header *header)
+{
+    QString files[CONFIG_FILES];
+    if (!configFiles(files))
+        return false;
+    memset(header, 0, sizeof(Header));
+    header->version = SNAPSHOT_VERSION;
+    header->size = sizeof(Snapshot::Settings);
+    for (int i = 0; i < CONFIG_FILES; ++i) {
+        const QFileInfo info(files[i]);
+        if (info.exists()) {
+            header->stamp[i][0] = info.lastModified().toMSecsSinceEpoch();
+            header->stamp[i][1] = info.size();
+        } else {
+            header->stamp[i][0] = header->stamp[i][1] = -1;
+        }
+    }
+    return true;
+}
+
+bool
+Snapshot::load(Settings *settings)
+{
+    Header current;
+    if (!makeHeader(&current))
+        return false;
+    QByteArray data;
+    if (!DiskCache::loadData(SNAPSHOT_KEY, &data) || data.size() != int(sizeof(Header) + sizeof(Settings)))
+        return false;
+    if (memcmp(data.constData(), &current, sizeof(Header)))
+        return false; // outdated style or the settings were changed since
+    memcpy(settings, data.constData() + sizeof(Header), sizeof(Settings));
+    return true;
+}
+
+#define readInt(_DEF_) iSettings.value(_DEF_).toInt()
+#define readBool(_DEF_) iSettings.value(_DEF_).toBool()
+
+void
+Snapshot::compile(Settings *settings)
+{
+    // stamp before reading, so a change meanwhile rather invalidates the snapshot
+    Header header;
+    const bool store = makeHeader(&header);
+
+    Settings s;
+    memset(&s, 0, sizeof(Settings)); // it's dumped as is, padding included
+    QSettings iSettings("BE", "Style");
+    iSettings.beginGroup("Current");
+
+    s.leftHanded = readBool(LEFTHANDED);
+    s.macStyle = readBool(MACSTYLE);
+    s.dialogBtnLayout = readInt(DIALOG_BTN_LAYOUT);
+    s.fadeInactive = readBool(FADE_INACTIVE);
+
+    s.hack.windowMovement = readBool(HACK_WINDOWMOVE);
+    s.hack.fixGwenview = readBool(HACK_FIX_GWENVIEW);
+    s.hack.lockToolBars = readBool(HACK_TOOLBAR_LOCKING);
+    s.hack.lockDocks = readBool(HACK_DOCK_LOCKING);
+    s.hack.panning = readBool(HACK_PANNING);
+    s.hack.suspendFullscreenPlayers = readBool(HACK_SUSPEND_FULLSCREEN_PLAYERS);
+    s.hack.titleWidgets = readBool(HACK_TITLE_WIDGET);
+    s.hack.suppressBrightnessOSD = readBool(HACK_BRIGHTNESS_OSD);
+
+    s.hasFontExtent = iSettings.contains("FontExtent");
+    s.fontExtent = iSettings.value("FontExtent").toInt();
+    const QStringList lst = iSettings.value("FontOffset", QStringList()).toStringList();
+    s.fontOffsets = qMin(lst.count(), 2);
+    for (int i = 0; i < s.fontOffsets; ++i)
+        s.fontOffset[i] = lst.at(i).toInt();
+
+    s.pwEchoChar = ushort(iSettings.value(INPUT_PWECHOCHAR).toUInt());
+
+    s.menu.delay = readInt(MENU_DELAY);
+    s.menu.showIcons = readBool(MENU_SHOWICONS);
+    s.menu.indent = readBool(MENU_INDENT);
+
+    s.tab.transition = readInt(TAB_TRANSITION);
+    s.tab.duration = iSettings.value(TAB_DURATION).toUInt();
+
+    s.invert.docks = readBool(INVERT_DOCKS);
+    s.invert.headers = readBool(INVERT_HEADERS);
+    s.invert.menubars = readBool(INVERT_MENUBARS);
+    s.invert.menus = readBool(INVERT_MENUS);
+    s.invert.modals = readBool(INVERT_MODALS);
+    s.invert.titlebars = readBool(INVERT_TITLEBARS);
+    s.invert.toolbars = readBool(INVERT_TOOLBARS);
+
+    s.bg.opacity = readInt(BG_OPACITY);
+    s.bg.modalOpacity = readInt(BG_MODAL_OPACITY);
+    s.bg.blur = readBool(BG_BLUR);
+    s.bg.ringOverlay = readInt(BG_RING_OVERLAY);
+
+    s.btn.minHeight = readInt(BTN_MIN_HEIGHT);
+    s.btn.disabledToolStyle = readInt(BTN_DISABLED_TOOLS);
+
+    s.slider.buttons = readBool(SLIDER_BUTTONS);
+    s.slider.thickness = readInt(SLIDER_THICKNESS);
+    s.showMnemonic = readBool(SHOW_MNEMONIC);
+    s.roundness = readInt(ROUNDNESS);
+    s.strokeWidth = readInt(STROKE_WIDTH);
+
+    iSettings.endGroup();
+
+    if (store) {
+        QByteArray data(reinterpret_cast<const char*>(&header), sizeof(Header));
+        data.append(reinterpret_cast<const char*>(&s), sizeof(Settings));
+        DiskCache::storeData(SNAPSHOT_KEY, data);
+    }
+    if (settings)
+        *settings = s;
+}
+
+#undef readInt
+#undef readBool
@@ -0,0 +1,78 @@
+/*
+ *   Virtuality Style for Qt4 and Qt5
+ *   Copyright 2009-2014 by Thomas Lübking <thomas.luebking@gmail.com>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License version 2
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details
+ *
+ *   You should have received a copy of the GNU General Public
+ *   License along with this program; if not, write to the
+ *   Free Software Foundation, Inc.,
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef BE_SNAPSHOT_H
+#define BE_SNAPSHOT_H
+
+#include <QtGlobal>
+
+namespace BE {
+namespace Snapshot {
+
+/**
+ * The "Current" group of the style settings as plain struct, ie. what BE::Config and
+ * Hacks::config are derived from - before any application specific adjustments.
+ * compile() reads it from QSettings and keeps a binary copy in the DiskCache, load() reads
+ * that copy and refuses it if the layout changed or any of the config files was touched since.
+ * The config tool compiles after saving, the style whenever load() fails.
+ * Bump SNAPSHOT_VERSION (snapshot.cpp) when changing the layout.
+ */
+typedef struct {
+    bool leftHanded, macStyle, fadeInactive;
+    qint32 dialogBtnLayout;
+    struct {
+        bool windowMovement, fixGwenview, lockToolBars, lockDocks,
+             panning, suspendFullscreenPlayers, titleWidgets, suppressBrightnessOSD;
+    } hack;
+    // font fixing overrides, if any - the measured offsets apply otherwise
+    bool hasFontExtent;
+    qint32 fontExtent, fontOffsets, fontOffset[2];
+    quint16 pwEchoChar;
+    struct {
+        qint32 delay;
+        bool showIcons, indent;
+    } menu;
+    struct {
+        qint32 transition, duration;
+    } tab;
+    struct {
+        bool docks, headers, menubars, menus, modals, titlebars, toolbars;
+    } invert;
+    struct {
+        qint32 opacity, modalOpacity, ringOverlay;
+        bool blur;
+    } bg;
+    struct {
+        qint32 minHeight, disabledToolStyle;
+    } btn;
+    struct {
+        bool buttons;
+        qint32 thickness;
+    } slider;
+    bool showMnemonic;
+    qint32 roundness, strokeWidth;
+} Settings;
+
+bool load(Settings *settings);
+// reads the QSettings and stores the snapshot, *settings receives the values if passed
+void compile(Settings *settings = 0);
+
+}
+}
+
+#endif // BE_SNAPSHOT_H
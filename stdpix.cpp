@@ -25,6 +25,7 @@
 #include <QPen>
 
 #include "FX.h"
+#include "pixcache.h"
 #include "shapes.h"
 #include "virtuality.h"
 
@@ -48,6 +49,27 @@ static inline uint qt_intensity(uint r, uint g, uint b)
     return (77 * r + 150 * g + 28 * b) / 255;
 }
 
+static bool
+isGlyph(QStyle::StandardPixmap standardPixmap)
+{
+    switch (standardPixmap) {
+    case QStyle::SP_TitleBarMenuButton:
+    case QStyle::SP_TitleBarMinButton:
+    case QStyle::SP_TitleBarMaxButton:
+    case QStyle::SP_TitleBarCloseButton:
+    case QStyle::SP_TitleBarNormalButton:
+    case QStyle::SP_TitleBarShadeButton:
+    case QStyle::SP_TitleBarUnshadeButton:
+    case QStyle::SP_TitleBarContextHelpButton:
+    case QStyle::SP_DockWidgetCloseButton:
+    case QStyle::SP_ToolBarHorizontalExtensionButton:
+    case QStyle::SP_ToolBarVerticalExtensionButton:
+        return true;
+    default: // message box icons depend on the font and are rarely asked for
+        return false;
+    }
+}
+
 #if 0
 static
 QPainterPath arrow( const QRect &rect, bool right = false )
@@ -105,10 +127,31 @@ Style::standardPixmap(StandardPixmap standardPixmap, const QStyleOption *option,
 
     const QDockWidget *dock = qobject_cast<const QDockWidget*>(widget);
     const int sz = dock ? 14 : rect.height();
+
+    // title bars, mdi and dock controls ask for their glyphs on every repaint
+    QByteArray key;
+    if (isGlyph(standardPixmap)) {
+        struct {
+            int id, sz, rect, style;
+            bool sunken, hover, floating;
+            QRgb fg, bg, window, windowText;
+        } k;
+        memset(&k, 0, sizeof(k));
+        k.id = standardPixmap; k.sz = sz; k.rect = rect.height(); k.style = config.winBtnStyle;
+        k.sunken = sunken; k.hover = hover; k.floating = dock && dock->isFloating();
+        k.fg = pal.color(fg).rgba(); k.bg = pal.color(bg).rgba();
+        k.window = COLOR(Window).rgba(); k.windowText = COLOR(WindowText).rgba();
+        key = PixCache::key('s', k);
+        QPixmap cached;
+        if (PixCache::find(key, &cached))
+            return cached;
+    }
+
     QPixmap pm(sz, sz);
     pm.fill(Qt::transparent);
     QPainter painter(&pm);
     QPainterPath shape;
+    int glyph = -1; // Shapes::Shape, if any
     Shapes::Style style = (Shapes::Style)config.winBtnStyle;
 
     switch (standardPixmap)
@@ -173,30 +216,30 @@ Style::standardPixmap(StandardPixmap standardPixmap, const QStyleOption *option,
     case SP_TitleBarCloseButton:
 //     case SP_BrowserStop:
 //     case SP_MediaStop:
-        shape = Shapes::close(pm.rect(), style);
+        glyph = Shapes::Close;
         goto paint;
     case SP_TitleBarMinButton:
-        shape = Shapes::min(pm.rect(), style);
+        glyph = Shapes::Min;
         goto paint;
     case SP_TitleBarMaxButton:
-        shape = Shapes::max(pm.rect(), style);
+        glyph = Shapes::Max;
         goto paint;
     case SP_TitleBarMenuButton:
-        shape = Shapes::menu(pm.rect(), false, style);
+        glyph = Shapes::Menu;
         goto paint;
     case SP_TitleBarShadeButton:
     case SP_TitleBarUnshadeButton:
-        shape = Shapes::shade(pm.rect(), style);
+        glyph = Shapes::Shade;
         goto paint;
     case SP_TitleBarNormalButton:
         if (dock)
-            shape = Shapes::dockControl(pm.rect(), dock->isFloating(), style);
+            glyph = dock->isFloating() ? Shapes::FloatingDockControl : Shapes::DockControl;
         else
-            shape = Shapes::restore(pm.rect(), style);
+            glyph = Shapes::Restore;
         goto paint;
     case SP_TitleBarContextHelpButton:
     {
-        shape = Shapes::help(pm.rect(), style);
+        glyph = Shapes::Help;
 #if 0
         goto paint;
     case SP_ArrowDown:
@@ -247,6 +290,13 @@ Style::standardPixmap(StandardPixmap standardPixmap, const QStyleOption *option,
 #endif
 paint:
         const QColor c = FX::blend(pal.color(fg), pal.color(bg), (sz > 16) ? 16 : 2, sunken ? 2 : (hover ? 4 : 2) );
+        if (glyph > -1 && sz <= 16) {
+            // unstroked, the shared mask only needs to be colored
+            painter.drawImage(0, 0, Shapes::tinted(Shapes::Shape(glyph), pm.size(), c, style));
+            break;
+        }
+        if (glyph > -1)
+            shape = Shapes::path(Shapes::Shape(glyph), pm.rect(), style);
         painter.setRenderHint ( QPainter::Antialiasing, true );
         if (sz > 16)
             painter.setPen(pal.color(bg));
@@ -401,9 +451,8 @@ paint:
         return QCommonStyle::standardPixmap ( standardPixmap, option, widget );
     }
     painter.end();
-#if 0
-    QPixmapCache::insert(key, pm);
-#endif
+    if (!key.isEmpty())
+        PixCache::insert(key, pm);
     return pm;
 }
 
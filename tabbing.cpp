@@ -476,7 +476,7 @@ Style::drawTabLabel(const QStyleOption *option, QPainter *painter, const QWidget
     // color adjustment
     bool elide(false);
     QColor cF, cB;
-    if (hasFocus && selected && FX::haveContrast(FCOLOR(Highlight), FCOLOR(WindowText))) {
+    if (hasFocus && selected && DERIVED(highlightOnWindowText)) {
         cF = FCOLOR(Highlight);
     } else if (customColor) {
         if (FX::haveContrast(inverted ? FCOLOR(WindowText) : FCOLOR(Window), painter->pen().color())) {
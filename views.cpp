@@ -23,6 +23,7 @@
 #include <QPushButton>
 #include <QTreeView>
 #include "draw.h"
+#include "pixcache.h"
 
 #include <QtDebug>
 
@@ -47,6 +48,85 @@ Style::drawHeader(const QStyleOption *option, QPainter *painter, const QWidget *
 //    painter->setClipRegion(clipRegion);
 }
 
+static QPainterPath
+sectionPath(const QRect &rect, char corners, int rnd)
+{
+    QPainterPath path;
+    const int rnd_2 = 2*rnd;
+    const QRect r(rect.adjusted(0,0,1,1));
+    if (corners & Corner::BottomRight) {
+        path.moveTo(r.right(), r.bottom() - rnd_2);
+        path.arcTo(r.right() - rnd_2, r.bottom() - rnd_2, rnd_2, rnd_2, 0, -90);
+    } else {
+        path.moveTo(r.bottomRight());
+    }
+    if (corners & Corner::BottomLeft) {
+        path.lineTo(r.x() + rnd, r.bottom());
+        path.arcTo(r.x(), r.bottom() - rnd_2, rnd_2, rnd_2, -90, -90);
+    } else {
+        path.lineTo(r.bottomLeft());
+    }
+    if (corners & Corner::TopLeft) {
+        path.lineTo(r.x(), r.y() + rnd);
+        path.arcTo(r.x(), r.y(), rnd_2, rnd_2, 180, -90);
+    } else {
+        path.lineTo(r.topLeft());
+    }
+    if (corners & Corner::TopRight) {
+        path.lineTo(r.right() - rnd, r.y());
+        path.arcTo(r.right() - rnd_2, r.y(), rnd_2, rnd_2, 90, -90);
+    } else {
+        path.lineTo(r.topRight());
+    }
+    path.closeSubpath();
+    return path;
+}
+
+/**
+ * Wide tables repaint all visible sections on every horizontal scroll.
+ * Inner sections are plain rects, only the first and last one have rounded corners
+ * and those are stretched from a sprite per corners, roundness and color
+ */
+static void
+drawSectionBg(QPainter *painter, const QRect &rect, char corners, const QColor &c)
+{
+    const int rnd = Style::config.frame.roundness;
+    if (!(corners && rnd > 0)) {
+        painter->fillRect(rect, c);
+        return;
+    }
+    const int m = 2*rnd + 1;
+    const QSize size(2*m + 1, 2*m + 1);
+    if (rect.width() < size.width() || rect.height() < size.height() || !PixCache::accepts(painter, size)) {
+        painter->setPen(Qt::NoPen);
+        painter->setBrush(c);
+        painter->setRenderHint(QPainter::Antialiasing, true);
+        painter->drawPath(sectionPath(rect, corners, rnd));
+        return;
+    }
+
+    struct {
+        int corners, rnd;
+        QRgb color;
+        qreal dpr;
+    } k;
+    memset(&k, 0, sizeof(k));
+    k.corners = corners; k.rnd = rnd; k.color = c.rgba(); k.dpr = PixCache::dpr(painter);
+    const QByteArray key = PixCache::key('h', k);
+    QPixmap sprite;
+    if (!PixCache::find(key, &sprite)) {
+        sprite = PixCache::pixmap(size, k.dpr);
+        QPainter p(&sprite);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(Qt::NoPen);
+        p.setBrush(c);
+        p.drawPath(sectionPath(QRect(QPoint(0,0), size), corners, rnd));
+        p.end();
+        PixCache::insert(key, sprite);
+    }
+    PixCache::drawNineSlice(painter, rect, sprite, QMargins(m, m, m, m), PixCache::All);
+}
+
 void
 Style::drawHeaderSection(const QStyleOption *option, QPainter *painter, const QWidget *widget) const
 {
@@ -81,7 +161,7 @@ Style::drawHeaderSection(const QStyleOption *option, QPainter *painter, const QW
             c = FCOLOR(Highlight);
         } else if (hover) {
             paintBg = true;
-            c = FX::blend(FCOLOR(Base), FCOLOR(Highlight), 3, 1);
+            c = DERIVED(baseHover);
         } else {
             painter->setPen(QPen(FRAME_COLOR, FRAME_STROKE_WIDTH));
             STROKED_RECT(r, RECT);
@@ -103,45 +183,8 @@ Style::drawHeaderSection(const QStyleOption *option, QPainter *painter, const QW
         }
     }
 
-    if (paintBg) {
-        painter->setPen(Qt::NoPen);
-        painter->setBrush(c);
-
-        QPainterPath path;
-        const int rnd(config.frame.roundness);
-        const int rnd_2 = 2*rnd;
-        const QRect r(RECT.adjusted(0,0,1,1));
-        if (corners & Corner::BottomRight) {
-            painter->setRenderHint(QPainter::Antialiasing, true);
-            path.moveTo(r.right(), r.bottom() - rnd_2);
-            path.arcTo(r.right() - rnd_2, r.bottom() - rnd_2, rnd_2, rnd_2, 0, -90);
-        } else {
-            path.moveTo(r.bottomRight());
-        }
-        if (corners & Corner::BottomLeft) {
-            painter->setRenderHint(QPainter::Antialiasing, true);
-            path.lineTo(r.x() + rnd, r.bottom());
-            path.arcTo(r.x(), r.bottom() - rnd_2, rnd_2, rnd_2, -90, -90);
-        } else {
-            path.lineTo(r.bottomLeft());
-        }
-        if (corners & Corner::TopLeft) {
-            painter->setRenderHint(QPainter::Antialiasing, true);
-            path.lineTo(r.x(), r.y() + rnd);
-            path.arcTo(r.x(), r.y(), rnd_2, rnd_2, 180, -90);
-        } else {
-            path.lineTo(r.topLeft());
-        }
-        if (corners & Corner::TopRight) {
-            painter->setRenderHint(QPainter::Antialiasing, true);
-            path.lineTo(r.right() - rnd, r.y());
-            path.arcTo(r.right() - rnd_2, r.y(), rnd_2, rnd_2, 90, -90);
-        } else {
-            path.lineTo(r.topRight());
-        }
-        path.closeSubpath();
-        painter->drawPath(path);
-    }
+    if (paintBg)
+        drawSectionBg(painter, RECT, corners, c);
 
     if (!header || header->position < QStyleOptionHeader::End) {
         painter->setRenderHint(QPainter::Antialiasing, false);
@@ -20,6 +20,7 @@
 
 #include <QAbstractScrollArea>
 #include <QApplication>
+#include <QCache>
 #include <QComboBox>
 #include <QDockWidget>
 #include <QElapsedTimer>
@@ -33,6 +34,7 @@
 #include <QMouseEvent>
 #include <QPainter>
 #include <QPaintEvent>
+#include <QPointer>
 #include <QPushButton>
 #include <QStyleOptionTabWidgetFrame>
 #include <QStylePlugin>
@@ -42,7 +44,6 @@
 #include <QToolBar>
 #include <QToolButton>
 #include <QTreeView>
-#include <QWeakPointer>
 
 /**============= Bespin includes ==========================*/
 
@@ -54,8 +55,14 @@
 #endif
 #include "FX.h"
 #include "animator/hover.h"
+#include "capabilities.h"
+#include "cyclequeue.h"
 #include "shadows.h"
 #include "hacks.h"
+#include "pixcache.h"
+#include "profiler.h"
+#include "shapes.h"
+#include "snapshot.h"
 #include "virtuality.h"
 
 #include <QtDebug>
@@ -245,20 +252,85 @@ Style::registerRoutines()
     registerCE(drawSizeGrip, CE_SizeGrip);
 }
 
+bool
+Style::hasRoutine(RoutineType type, int element)
+{
+    if (element < 0)
+        return false;
+    switch (type) {
+    case PrimitiveRoutine:
+        return element < N_PE && primitiveRoutine[element];
+    case ControlRoutine:
+        return element < N_CE && controlRoutine[element];
+    case ComplexRoutine:
+        return element < N_CC && complexRoutine[element];
+    }
+    return false;
+}
+
 /**THE STYLE ITSELF*/
 
+extern const QString virtuality_revision();
+
+/**
+ * Everything the style computes is static (config, Dpi::target, the routines, the polished
+ * standard palette, caches) - some applications (TEA editor at least) create a new style
+ * every now and then, so a new instance just takes over what the previous one left as long as
+ * the variant, settings and font are the same. The last instance to go releases it all.
+ */
+struct SharedState {
+    SharedState() : refs(0), palette(0) {}
+    int refs;
+    QByteArray key; // what the state was computed from
+    QPalette *palette;
+};
+static SharedState gs_shared;
+
+static QByteArray
+sharedStateKey(const QString &name)
+{
+    Snapshot::Settings settings;
+    if (!Snapshot::load(&settings))
+        return QByteArray(); // changed or not compiled yet, won't match anything
+    QByteArray key(reinterpret_cast<const char*>(&settings), sizeof(Snapshot::Settings));
+    key += name.toUtf8() + '\0' + qApp->font().toString().toUtf8() + '\0' + qgetenv("VIRTUALITY_SCALE");
+    return key;
+}
+
 Style::Style(const QString &name) : QCommonStyle()
 {
     m_usingStandardPalette = (name == "sienar" || name == "flynn" || name == "virtualbreeze");
     setObjectName(name);
+    setProperty("VirtualityStyleRevision", virtuality_revision());
+    Profiler::init();
+    Profiler::PhaseTimer time; time.start();
+    const QByteArray key = sharedStateKey(name);
+    const bool shared = gs_shared.refs && !key.isEmpty() && key == gs_shared.key;
+    ++gs_shared.refs;
+    PROFILE_PHASE(shared ? "shared state (reused)" : "shared state (rebuilt)", time);
+    if (!shared) {
 #ifdef BE_WS_X11
-    if (BE::isPlatformX11()) // TODO: port XProperty for wayland
-        BE::XProperty::init();
+        if (BE::isPlatformX11()) // TODO: port XProperty for wayland
+            BE::XProperty::init();
+        PROFILE_PHASE("XProperty::init", time);
 #endif
-    FX::init();
+        FX::init();
+        PROFILE_PHASE("FX::init", time);
+    }
     if (m_usingStandardPalette) {
-        originalPalette = new QPalette(standardPalette());
-        polish(*originalPalette, true);
+        if (!shared || !gs_shared.palette) {
+            QPalette pal(standardPalette());
+            polish(pal, true);
+            if (gs_shared.palette)
+                *gs_shared.palette = pal;
+            else
+                gs_shared.palette = new QPalette(pal);
+            PROFILE_PHASE("palette polish", time);
+        }
+        if (originalPalette)
+            *originalPalette = *gs_shared.palette;
+        else
+            originalPalette = new QPalette(*gs_shared.palette);
         static bool isRecursion = false;
         if (!isRecursion) {
             isRecursion = true; // some applications (TEA editor at least) are aggressive on forcing
@@ -266,18 +338,37 @@ Style::Style(const QString &name) : QCommonStyle()
                                 // therefore detect this and escape the recursion.
                                 // TEA looks pretty ... interesting ... anyway ;-P
             QApplication::setPalette(*originalPalette);
+            PROFILE_PHASE("QApplication::setPalette", time);
             qApp->installEventFilter(this);
             QTimer::singleShot(10000, this, SLOT(removeAppEventFilter()));
             isRecursion = false;
         }
     }
-    init();
-    registerRoutines();
+    connect(Capabilities::instance(), SIGNAL(compositingChanged(bool)), SLOT(windowSystemChanged()));
+    connect(Capabilities::instance(), SIGNAL(shadowsChanged(bool)), SLOT(windowSystemChanged()));
+    connect(Capabilities::instance(), SIGNAL(blurChanged(bool)), SLOT(windowSystemChanged()));
+    if (!shared) {
+        init();
+        PROFILE_PHASE("init", time);
+        registerRoutines();
+        PROFILE_PHASE("registerRoutines", time);
+        // init() may have compiled the snapshot or scaled the application font
+        gs_shared.key = sharedStateKey(name);
+    }
+    if (Profiler::startupActive)
+        Profiler::dumpStartup();
 }
 
 Style::~Style()
 {
-    Shadows::cleanUp();
+    if (!--gs_shared.refs) {
+        Shadows::cleanUp();
+        PixCache::clear();
+        Shapes::clearCache();
+        delete gs_shared.palette;
+        gs_shared.palette = 0;
+        gs_shared.key.clear();
+    }
     // reset palette
     if (!m_usingStandardPalette)
         return;
@@ -387,6 +478,7 @@ Style::drawPrimitive(PrimitiveElement pe, const QStyleOption *option, QPainter *
 {
     Q_ASSERT(option);
     Q_ASSERT(painter);
+    PROFILE_PAINT_START;
 
 //    if (pe == PE_IndicatorItemViewItemDrop)
 // An indicator that is drawn to show where an item in an item view is about to
@@ -402,6 +494,7 @@ Style::drawPrimitive(PrimitiveElement pe, const QStyleOption *option, QPainter *
         qDebug() << "drawPrimitive : unbalanced painter" << pe << gs_painterStore.flags;
         gs_painterStore.flags = 0;
     }
+    PROFILE_PAINT_STOP(Primitive, pe);
 }
 
 void
@@ -409,6 +502,7 @@ Style::drawControl(ControlElement element, const QStyleOption *option, QPainter
 {
     Q_ASSERT(option);
     Q_ASSERT(painter);
+    PROFILE_PAINT_START;
     if (element < N_CE && controlRoutine[element])
         (this->*controlRoutine[element])(option, painter, widget);
     else if (element > X_KdeBase) {
@@ -424,6 +518,7 @@ Style::drawControl(ControlElement element, const QStyleOption *option, QPainter
         qDebug() << "drawControl : unbalanced painter" << element;
         gs_painterStore.flags = 0;
     }
+    PROFILE_PAINT_STOP(Control, element);
 }
 
 void
@@ -431,6 +526,7 @@ Style::drawComplexControl(ComplexControl control, const QStyleOptionComplex *opt
 {
     Q_ASSERT(option);
     Q_ASSERT(painter);
+    PROFILE_PAINT_START;
     if (control < N_CC && complexRoutine[control])
         (this->*complexRoutine[control])(option, painter, widget);
     else {
@@ -441,6 +537,7 @@ Style::drawComplexControl(ComplexControl control, const QStyleOptionComplex *opt
         qDebug() << "drawComplexControl : unbalanced painter" << control;
         gs_painterStore.flags = 0;
     }
+    PROFILE_PAINT_STOP(Complex, control);
 }
 
 int
@@ -470,15 +567,76 @@ Style::elementId(const QString &string) const
 
 /// ----------------------------------------------------------------------
 
+/**
+ * erase() paints the background of the next opaque ancestor, which is looked up once per widget.
+ * The chain up to that ancestor is watched, anything that could change the result drops the
+ * cache (those events are rare compared to scrollbar paints)
+ */
+class EraseCache : public QObject {
+public:
+    typedef struct {
+        QPointer<QWidget> widget, provider;
+        QPoint offset;
+    } Entry;
+    QHash<const QWidget*, Entry> entries;
+    void watch(QWidget *w)
+    {
+        QPointer<QObject> &watched = m_watched[w];
+        if (watched) // the pointer might be recycled
+            return;
+        watched = w;
+        w->installEventFilter(this);
+    }
+protected:
+    bool eventFilter(QObject *, QEvent *ev)
+    {
+        switch (ev->type()) {
+        case QEvent::ParentChange:
+        case QEvent::Move:
+        case QEvent::Resize:
+        case QEvent::PaletteChange:
+            entries.clear();
+            // nothing to watch for anymore
+            for (QHash<QObject*, QPointer<QObject> >::const_iterator it = m_watched.constBegin(),
+                                                                     end = m_watched.constEnd(); it != end; ++it) {
+                if (it.value())
+                    it.value()->removeEventFilter(this);
+            }
+            m_watched.clear();
+            return false;
+        default:
+            return false;
+        }
+    }
+private:
+    QHash<QObject*, QPointer<QObject> > m_watched;
+};
+
+static EraseCache *gs_eraseCache = 0;
+
 void
 Style::erase(const QStyleOption *option, QPainter *painter, const QWidget *widget, const QPoint *offset) const
 {
-    const QWidget *grampa = widget;
-    while ( !(grampa->isWindow() ||
-            (grampa->autoFillBackground() && grampa->objectName() != "qt_scrollarea_viewport")))
-        grampa = grampa->parentWidget();
+    if (!gs_eraseCache)
+        gs_eraseCache = new EraseCache;
+    EraseCache::Entry &entry = gs_eraseCache->entries[widget];
+    // the widget check catches recycled pointers, autoFillBackground() has no change event
+    if (!(entry.widget.data() == widget && entry.provider &&
+          (entry.provider->isWindow() || entry.provider->autoFillBackground()))) {
+        QWidget *grampa = const_cast<QWidget*>(widget);
+        gs_eraseCache->watch(grampa);
+        while ( !(grampa->isWindow() ||
+                (grampa->autoFillBackground() && grampa->objectName() != "qt_scrollarea_viewport"))) {
+            grampa = grampa->parentWidget();
+            gs_eraseCache->watch(grampa);
+        }
+        entry.widget = const_cast<QWidget*>(widget);
+        entry.provider = grampa;
+        entry.offset = widget->mapFrom(grampa, QPoint());
+    }
+    const QWidget *grampa = entry.provider;
 
-    QPoint tl = widget->mapFrom(const_cast<QWidget*>(grampa), QPoint());
+    QPoint tl = entry.offset;
     if (offset)
         tl += *offset;
     painter->save();
@@ -514,32 +672,62 @@ Style::erase(const QStyleOption *option, QPainter *painter, const QWidget *widge
     painter->restore();
 }
 
-static bool _serverSupportsShadows = false;
-static QElapsedTimer _lastCheckTime;
+// palettes change rarely but get copied for every other widget. The cacheKey() is shared among
+// the copies and the cache is bound for the odd app that tweaks a palette per paint
+struct DerivedPalette { DerivedColors group[3]; };
+static QCache<qint64, DerivedPalette> gs_derivedColors(32);
+static qint64 gs_lastDerivedKey = 0;
+static DerivedPalette *gs_lastDerived = 0;
+
+void
+Style::invalidateDerivedColors()
+{
+    gs_derivedColors.clear();
+    gs_lastDerivedKey = 0;
+    gs_lastDerived = 0;
+}
+
+const DerivedColors &
+Style::derivedColors(const QPalette &pal)
+{
+    const int group = qMin(int(pal.currentColorGroup()), 2);
+    const qint64 key = pal.cacheKey();
+    if (gs_lastDerived && key == gs_lastDerivedKey)
+        return gs_lastDerived->group[group];
+
+    DerivedPalette *colors = gs_derivedColors.object(key);
+    if (!colors) {
+        colors = new DerivedPalette;
+        for (int i = 0; i < 3; ++i) {
+            const QPalette::ColorGroup cg = QPalette::ColorGroup(i);
+            DerivedColors &c = colors->group[i];
+            const QColor &window = pal.color(cg, QPalette::Window), &windowText = pal.color(cg, QPalette::WindowText),
+                         &base = pal.color(cg, QPalette::Base), &text = pal.color(cg, QPalette::Text),
+                         &highlight = pal.color(cg, QPalette::Highlight);
+            c.frame = FX::blend(window, windowText, 8, 1);
+            c.focusFrame = FX::blend(window, highlight, 1, 2);
+            c.thermometer = FX::blend(window, windowText, 1, 4);
+            c.windowMid = FX::blend(window, windowText);
+            c.baseMid = FX::blend(base, text);
+            c.baseHover = FX::blend(base, highlight, 3, 1);
+            c.baseFocus = FX::blend(base, highlight, 6, 1);
+            c.highlightOnWindowText = FX::haveContrast(highlight, windowText);
+            c.buttonOnWindow = FX::haveContrast(pal.color(cg, QPalette::Button), window);
+            c.buttonTextOnWindow = FX::haveContrast(pal.color(cg, QPalette::ButtonText), window);
+        }
+        gs_derivedColors.insert(key, colors);
+    }
+    gs_lastDerivedKey = key;
+    gs_lastDerived = colors;
+    return colors->group[group];
+}
+
 bool
 Style::serverSupportsShadows()
 {
-    if (!BE::isPlatformX11())
-        return false; // TODO: port XProperty for wayland
     if (appType == KDM)
         return false;
-#ifdef BE_WS_X11
-    if (!_lastCheckTime.isValid() || _lastCheckTime.elapsed() > 1000*60*5)
-    {
-        unsigned long n = 0;
-        Atom *supported = BE::XProperty::get<Atom>(DefaultRootWindow(BE_X11_DISPLAY), BE::XProperty::netSupported, BE::XProperty::ATOM, &n);
-        for (uint i = 0; i < n; ++i)
-            if (supported[i] == BE::XProperty::kwinShadow)
-            {
-                _serverSupportsShadows = true;
-                break;
-            }
-        if (supported)
-            XFree(supported);
-        _lastCheckTime.start();
-    }
-#endif
-    return _serverSupportsShadows;
+    return Capabilities::shadows();
 }
 
 static bool equal(const QPalette &p1, const QPalette &p2)
@@ -674,65 +862,6 @@ Qt::WindowFlags ignoreForDecoHints = ( Qt::Popup | Qt::SubWindow |
 Qt::ToolTip | Qt::SplashScreen | Qt::Desktop | Qt::X11BypassWindowManagerHint /*| Qt::FramelessWindowHint*/ ) & (~(Qt::Dialog|Qt::Sheet));
 
 
-static void detectBlurRegion(QWidget *window, const QWidget *widget, QRegion &blur)
-{
-    const QObjectList &kids = widget->children();
-    QObjectList::const_iterator i;
-    for ( i = kids.begin(); i != kids.end(); ++i )
-    {
-        QObject *o = (*i);
-        if ( !o->isWidgetType() )
-            continue;
-        QWidget *w = static_cast<QWidget*>(o);
-        if ( w->isVisible() &&
-            ((w->autoFillBackground() && w->palette().color(w->backgroundRole()).alpha() > 160) || (w->testAttribute(Qt::WA_OpaquePaintEvent) && !(qobject_cast<const QScrollBar*>(w) || w->inherits("QProgressBar")))) )
-        {
-            QPoint offset = w->mapTo(window, QPoint(0,0));
-            if (w->mask().isEmpty())
-                blur -= w->rect().translated(offset);
-            else
-                blur -= w->mask().translated(offset);
-            continue; // ne nood for deeper checks
-        }
-        else
-            detectBlurRegion(window, w, blur);
-    }
-}
-
-static QList<QWeakPointer<QWidget> > pendingBlurUpdates;
-
-void
-Style::updateBlurRegions() const
-{
-#ifdef BE_WS_X11 // hint blur region for the kwin plugin
-    if (!BE::isPlatformX11())
-        return; // TODO: port XProperty for wayland
-    for (QList<QWeakPointer<QWidget> >::const_iterator it = pendingBlurUpdates.constBegin(),
-                                                  end = pendingBlurUpdates.constEnd(); it != end; ++it)
-    {
-        if (!*it)
-            continue;
-        QSharedPointer<QWidget> widget = it->toStrongRef();
-        if (widget && !(widget->testAttribute(Qt::WA_WState_Created) || widget->internalWinId()))
-            continue; // protect against pseudo widgets, see setupDecoFor()
-
-        QRegion blur = widget->mask().isEmpty() ? widget->rect() : widget->mask();
-        detectBlurRegion(widget.data(), widget.data(), blur);
-        if (blur.isEmpty())
-            continue;
-
-        QVector<unsigned long> data(blur.rectCount() * 4);
-        for ( auto i = blur.begin(); i != blur.end(); ++i )
-        {
-            if (i->width() > 0 && i->height() > 0)
-                data << i->x() << i->y() << i->width() << i->height();
-        }
-        BE::XProperty::set<unsigned long>(widget->winId(), BE::XProperty::blurRegion, (unsigned long*)data.constData(), BE::XProperty::LONG, data.size());
-    }
-#endif
-    pendingBlurUpdates.clear();
-}
-
 static void shapeCorners( QWidget *widget, bool forceShadows )
 {
 #ifdef BE_WS_X11
@@ -759,28 +888,69 @@ static void shapeCorners( QWidget *widget, bool forceShadows )
     widget->setMask(mask);
 }
 
+#ifdef BE_WS_X11
+/**
+ * _KDE_NET_WM_BLUR_BEHIND_REGION only depends on the window size and whether it's rounded,
+ * but interactive resizes send several Resize events per frame - write at most once per frame.
+ */
+class BlurRegions : public WindowExport< QVector<unsigned long> >
+{
+public:
+    BlurRegions() : WindowExport< QVector<unsigned long> >(16) {} // ~ once per frame
+    void request(QWidget *window, bool round)
+    {
+        QVector<unsigned long> data;
+        if (round) {
+            const int w = window->width(), h = window->height();
+            data.reserve(16);
+            data << 4 << 0 << w - 8 << h
+                 << 0 << 4 << w << h - 8
+                 << 2 << 1 << w - 4 << h - 2
+                 << 1 << 2 << w - 2 << h - 4;
+        } else {
+            data << 0;
+        }
+        WindowExport< QVector<unsigned long> >::request(window, data);
+    }
+protected:
+    void exportValue(QWidget *window, const QVector<unsigned long> &data)
+    {
+        BE::XProperty::set<unsigned long>(window->winId(), BE::XProperty::blurRegion, data.data(), BE::XProperty::LONG, data.size());
+    }
+};
+static BlurRegions gs_blurRegions;
+#endif
+
 void reBlur(QWidget *widget, bool round) {
 #ifdef BE_WS_X11
     if (!(widget->windowOpacity() < 1.0 && widget->testAttribute(Qt::WA_WState_Created) &&
           widget->internalWinId() && BE::isPlatformX11())) // TODO: port XProperty for wayland
         return;
+    if (!Capabilities::blur())
+        return; // nobody to read it, windowSystemChanged() catches up
+    gs_blurRegions.request(widget, round);
+#endif
+}
 
-    if (!round) {
-        unsigned long zero(0);
-        XProperty::set<unsigned long>(widget->winId(), XProperty::blurRegion, &zero, XProperty::LONG, 1);
-        return;
-    }
-
-    const int w = widget->rect().width();
-    const int h = widget->rect().height();
-    QVector<unsigned long> data(4 * 4);
-    data << 4 << 0 << w - 8 << h
-         << 0 << 4 << w << h - 8
-         << 2 << 1 << w - 4 << h - 2
-         << 1 << 2 << w - 2 << h - 4;
-
-    BE::XProperty::set<unsigned long>(widget->winId(), BE::XProperty::blurRegion, (unsigned long*)data.constData(), BE::XProperty::LONG, data.size());
+void
+Style::windowSystemChanged()
+{
+    // masks and translucency of visible windows depend on compositing and shadow support
+    foreach (QWidget *w, QApplication::topLevelWidgets()) {
+        if (!w->isVisible())
+            continue;
+        if (config.frame.roundness > 2 && qobject_cast<QMenu*>(w))
+            shapeCorners(w, false);
+        if (w->testAttribute(Qt::WA_TranslucentBackground))
+            w->update();
+#ifdef BE_WS_X11
+        if (config.bg.blur)
+            reBlur(w, config.frame.roundness > 2);
 #endif
+    }
+    // a new compositor shall know the shadows right away
+    if (Capabilities::shadows())
+        Shadows::refresh();
 }
 
 bool
@@ -800,8 +970,12 @@ Style::eventFilter( QObject *object, QEvent *ev )
         if (window->testAttribute(Qt::WA_StyledBackground))
         if (window->isWindow())
         {
+            const QRegion &exposed = static_cast<QPaintEvent*>(ev)->region();
+            if (exposed.isEmpty())
+                return false;
             QPainter p(window);
-            p.setClipRegion( static_cast<QPaintEvent*>(ev)->region() );
+            if (exposed.rectCount() > 1 || !exposed.boundingRect().contains(window->rect()))
+                p.setClipRegion(exposed); // drawWindowBg only paints what's exposed
             drawWindowBg(0, &p, window);
             p.end();
             return false;
@@ -1101,8 +1275,7 @@ Style::eventFilter( QObject *object, QEvent *ev )
             widget->isWindow() && !(widget->windowFlags() & ignoreForDecoHints) &&
             BE::isPlatformX11()) // TODO: port XProperty for wayland
         {
-            setupDecoFor(widget, widget->palette());
-            BE::XProperty::remove(widget->winId(), BE::XProperty::bgPics);
+            setupDecoFor(widget, widget->palette(), true);
             return false;
         }
 #endif
@@ -42,6 +42,16 @@ class QToolBar;
 namespace BE
 {
 
+/**
+ * Colors the draw routines derive from the palette over and over again.
+ * One set per color group, see Style::derivedColors()
+ */
+typedef struct DerivedColors
+{
+    QColor frame, focusFrame, thermometer, windowMid, baseMid, baseHover, baseFocus;
+    bool highlightOnWindowText, buttonOnWindow, buttonTextOnWindow;
+} DerivedColors;
+
 #ifdef Q_WS_X11
 typedef struct _WindowData WindowData;
 #endif
@@ -103,6 +113,9 @@ public:
     static void drawArrow(Navi::Direction, const QRect&, QPainter*, const QWidget *w = 0);
     static void drawSolidArrow(Navi::Direction, const QRect&, QPainter*, const QWidget *w = 0);
     static bool serverSupportsShadows();
+    enum RoutineType { PrimitiveRoutine = 0, ControlRoutine, ComplexRoutine };
+    static bool hasRoutine(RoutineType type, int element);
+    static const DerivedColors &derivedColors(const QPalette &pal);
 
 public:
     static Config config;
@@ -255,7 +268,7 @@ private slots:
     void removeAppEventFilter();
     void resetRingPix();
     void unlockDocks(bool);
-    void updateBlurRegions() const;
+    void windowSystemChanged();
 
 private:
     enum PainterStorage { Pen = 1<<0, Brush = 1<<1, Alias = 1<<2, Font = 1<<3, Clip = 1<<4 };
@@ -263,10 +276,12 @@ private:
     int elementId(const QString &string) const;
     void erase(const QStyleOption*, QPainter*, const QWidget*, const QPoint *off = 0) const;
     void initMetrics();
+    static void invalidateDerivedColors();
     QColor mapFadeColor(const QColor &color, int index) const;
     void readSettings(QString appName = QString());
     void registerRoutines();
-    void setupDecoFor(QWidget *w, const QPalette &pal);
+    // dropPics also removes the background pictures along the changed hints
+    void setupDecoFor(QWidget *w, const QPalette &pal, bool dropPics = false);
     void swapPalette(QWidget *widget);
 
 private:
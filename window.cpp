@@ -20,8 +20,11 @@
 
 #include <QApplication>
 #include <QDockWidget>
+#include <QHash>
+#include <QImage>
 #include <QMainWindow>
 #include <QMetaObject>
+#include <QPointer>
 #include <QPainterPath>
 #include <QSplitter>
 #include <QTimer>
@@ -29,6 +32,7 @@
 #include "draw.h"
 
 #include "FX.h"
+#include "diskcache.h"
 
 #ifdef BE_WS_X11
 #include "xproperty.h"
@@ -36,9 +40,12 @@
 #define QT_NO_XRENDER #
 #endif
 
+// the corners shapeCorners() cuts for a roundness, at most 6px
+static inline int cornerSize(int rnd) { return qMin(rnd, 6); }
+
 static void shapeCorners( QPainter *p, const QRect &r, int rnd )
 {
-    rnd = qMin(rnd, 6);
+    rnd = cornerSize(rnd);
     static QPixmap mask;
     if (mask.isNull()) {
         mask = QPixmap(2*rnd+1, 2*rnd+1);
@@ -73,7 +80,7 @@ Style::drawWindowFrame(const QStyleOption *option, QPainter *painter, const QWid
 static QPixmap *gs_overlay = 0L;
 
 static inline void
-createRingPix(int alpha, int value)
+paintRingPix(QPainter &p, int alpha, int value)
 {
     QPainterPath ringPath;
 //     ringPath.setFillRule(Qt::WindingFill); // Qt::OddEvenFill (default)
@@ -95,9 +102,6 @@ createRingPix(int alpha, int value)
     ringPath.addEllipse(280,190,140,140);
     ringPath.addEllipse(310,220,80,80);
 
-    gs_overlay = new QPixmap(450,360);
-    gs_overlay->fill(Qt::transparent);
-    QPainter p(gs_overlay);
     QColor color(value,value,value,(alpha+16)*112/255);
     p.setPen(color);
 //     p.setPen(Qt::NoPen);
@@ -105,15 +109,11 @@ createRingPix(int alpha, int value)
     p.setBrush(color);
     p.setRenderHint(QPainter::Antialiasing);
     p.drawPath(ringPath);
-    p.end();
 }
 
 static inline void
-createImperialPix(const QColor &c)
+paintImperialPix(QPainter &p, const QColor &c)
 {
-    gs_overlay = new QPixmap(240,240);
-    gs_overlay->fill(Qt::transparent);
-    QPainter p(gs_overlay);
     p.setBrush(Qt::NoBrush);
     p.setRenderHint(QPainter::Antialiasing);
     QPen pen;
@@ -139,15 +139,11 @@ createImperialPix(const QColor &c)
     // gap (flat cap is required to have segments at all at this size ;-)
     // so we paint an arc and start at the uncovered 90° position
     p.drawArc(QRect(57,57,126,126), 90*16, 360*16);
-    p.end();
 }
 
 static inline void
-createTronPix(const QColor &c)
+paintTronPix(QPainter &p, const QColor &c)
 {
-    gs_overlay = new QPixmap(240,240);
-    gs_overlay->fill(Qt::transparent);
-    QPainter p(gs_overlay);
     p.setBrush(Qt::NoBrush);
     p.setRenderHint(QPainter::Antialiasing);
     QPen pen;
@@ -158,15 +154,11 @@ createTronPix(const QColor &c)
     pen.setWidth(8);
     p.setPen(pen);
     p.drawEllipse(56,56,128,128);
-    p.end();
 }
 
 static inline void
-createPlasmaPix(const QColor &c)
+paintPlasmaPix(QPainter &p, const QColor &c)
 {
-    gs_overlay = new QPixmap(210,210);
-    gs_overlay->fill(Qt::transparent);
-    QPainter p(gs_overlay);
     p.setBrush(c);
     p.setPen(Qt::NoPen);
     p.setRenderHint(QPainter::Antialiasing);
@@ -180,18 +172,11 @@ createPlasmaPix(const QColor &c)
     path.lineTo(130,120);
     p.setBrush(Qt::NoBrush);
     p.drawPath(path);
-    p.end();
 }
 
 static inline void
-createArtDecoPix(const QColor &c, Qt::Orientation o)
+paintArtDecoPix(QPainter &p, const QColor &c, Qt::Orientation o)
 {
-    if (o == Qt::Horizontal)
-        gs_overlay = new QPixmap(320,160);
-    else
-        gs_overlay = new QPixmap(160,320);
-    gs_overlay->fill(Qt::transparent);
-    QPainter p(gs_overlay);
     p.setPen(Qt::NoPen);
     p.setBrush(c);
     for (int y = 0; y < 160-24; y += 24) {
@@ -201,7 +186,59 @@ createArtDecoPix(const QColor &c, Qt::Orientation o)
         else
             p.drawRect(y, 0, 16, 320-x);
     }
-    p.end();
+}
+
+static QSize
+overlaySize(int type)
+{
+    switch (type) {
+        default:
+        case 1: return QSize(450,360);
+        case 2:
+        case 3: return QSize(240,240);
+        case 4: return QSize(210,210);
+        case 5: return QSize(320,160);
+        case 6: return QSize(160,320);
+    }
+}
+
+/**
+ * The overlays are large antialiased paths and the same for every process - so they're rendered
+ * once per type, color and scale and then loaded from the disk cache
+ */
+static void
+createOverlay(int type, const QColor &c)
+{
+#if QT_VERSION >= 0x050000
+    const qreal dpr = qApp->devicePixelRatio();
+#else
+    const qreal dpr = 1.0;
+#endif
+    const QSize size = overlaySize(type);
+    const QByteArray key = "overlay-" + QByteArray::number(type) + '-' + QByteArray::number(c.rgba(), 16) + '-' +
+                           QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height()) + '@' +
+                           QByteArray::number(dpr);
+    QImage img;
+    if (!DiskCache::loadImage(key, &img)) {
+        img = QImage(size*dpr, QImage::Format_ARGB32_Premultiplied);
+        img.fill(Qt::transparent);
+#if QT_VERSION >= 0x050000
+        img.setDevicePixelRatio(dpr);
+#endif
+        QPainter p(&img);
+        switch (type) {
+            default:
+            case 1: paintRingPix(p, 255, c.red()); break;
+            case 2: paintImperialPix(p, c); break;
+            case 3: paintTronPix(p, c); break;
+            case 4: paintPlasmaPix(p, c); break;
+            case 5: paintArtDecoPix(p, c, Qt::Horizontal); break;
+            case 6: paintArtDecoPix(p, c, Qt::Vertical); break;
+        }
+        p.end();
+        DiskCache::storeImage(key, img);
+    }
+    gs_overlay = new QPixmap(QPixmap::fromImage(img));
 }
 
 void
@@ -234,6 +271,89 @@ QWidget *dolphinViewContainer(bool search, const QWidget *from) {
     return NULL;
 }
 
+/**
+ * Whether the central widget corners meet inverted docks/toolbars depends on the docks, the
+ * neighbours and the window layout - this is resolved once and then only when any of the watched
+ * widgets moves, resizes, shows, hides or changes its properties
+ */
+class CentralCorners : public QObject {
+public:
+    typedef struct {
+        QPointer<QWidget> widget;
+        QRect rect;
+        bool valid, il, ir, it, ib;
+    } Entry;
+    QHash<const QWidget*, Entry> entries;
+    void watch(QWidget *w)
+    {
+        QPointer<QObject> &watched = m_watched[w];
+        if (watched) // the pointer might be recycled
+            return;
+        watched = w;
+        w->installEventFilter(this);
+    }
+protected:
+    bool eventFilter(QObject *, QEvent *ev)
+    {
+        switch (ev->type()) {
+        case QEvent::Move:
+        case QEvent::Resize:
+        case QEvent::Show:
+        case QEvent::Hide:
+        case QEvent::ParentChange:
+        case QEvent::ChildAdded:
+        case QEvent::ChildRemoved:
+        case QEvent::LayoutRequest:
+        case QEvent::DynamicPropertyChange:
+            entries.clear();
+            // the next lookup watches what it needs
+            for (QHash<QObject*, QPointer<QObject> >::const_iterator it = m_watched.constBegin(),
+                                                                     end = m_watched.constEnd(); it != end; ++it) {
+                if (it.value())
+                    it.value()->removeEventFilter(this);
+            }
+            m_watched.clear();
+            return false;
+        default:
+            return false;
+        }
+    }
+private:
+    QHash<QObject*, QPointer<QObject> > m_watched;
+};
+
+static CentralCorners *gs_centralCorners = 0;
+
+static void
+watchCorners(QWidget *w)
+{
+    gs_centralCorners->watch(w);
+}
+
+static CentralCorners::Entry &
+centralCorners(const QWidget *widget)
+{
+    if (!gs_centralCorners)
+        gs_centralCorners = new CentralCorners;
+    CentralCorners::Entry &entry = gs_centralCorners->entries[widget];
+    if (entry.widget.data() != widget) { // new or recycled pointer
+        entry.widget = const_cast<QWidget*>(widget);
+        entry.valid = false;
+        watchCorners(entry.widget);
+    }
+    return entry;
+}
+
+static bool
+invertedSibling(QWidget *parent, int x, int y)
+{
+    QWidget *sibling = parent->childAt(x, y);
+    if (!sibling)
+        return false;
+    watchCorners(sibling);
+    return sibling->property("Virtuality.inverted").toBool();
+}
+
 void
 Style::drawWindowBg(const QStyleOption *option, QPainter *painter, const QWidget *widget) const
 {
@@ -256,65 +376,73 @@ Style::drawWindowBg(const QStyleOption *option, QPainter *painter, const QWidget
             p.end();
         }
 
-        QWidget *window = widget->window();
-        const bool invertTitle = window->property("Virtuality.invertTitlebar").toBool();
-        const QRect parentRect(widget->parentWidget()->rect());
-        const QRect windowRect(window->rect());
-        const QRect geo(widget->geometry());
-        QRect r(widget->rect());
-        const QRect winGeo = (window == widget->parentWidget()) ? geo : r.translated(widget->mapTo(window, r.topLeft()));
-
-        Qt::DockWidgetAreas areas;
-        if (QMainWindow *mw = qobject_cast<QMainWindow*>(widget->parentWidget())) {
-            foreach (QObject *o, mw->children()) {
-                if (o->isWidgetType() && static_cast<QWidget*>(o)->isVisible())
-                if (QDockWidget *dock = qobject_cast<QDockWidget*>(o))
-                    areas |= mw->dockWidgetArea(dock);
+        CentralCorners::Entry &corners = centralCorners(widget);
+        if (!corners.valid) {
+            corners.valid = true;
+            QWidget *window = widget->window();
+            QWidget *parent = widget->parentWidget();
+            watchCorners(window);
+            watchCorners(parent);
+            const bool invertTitle = window->property("Virtuality.invertTitlebar").toBool();
+            const QRect parentRect(parent->rect());
+            const QRect geo(widget->geometry());
+            QRect r(widget->rect());
+            const QRect winGeo = (window == parent) ? geo : r.translated(widget->mapTo(window, r.topLeft()));
+
+            Qt::DockWidgetAreas areas;
+            if (QMainWindow *mw = qobject_cast<QMainWindow*>(parent)) {
+                foreach (QObject *o, mw->children()) {
+                    if (QDockWidget *dock = qobject_cast<QDockWidget*>(o)) {
+                        watchCorners(dock); // visibility and location
+                        if (dock->isVisible())
+                            areas |= mw->dockWidgetArea(dock);
+                    }
+                }
             }
-        }
 
-        bool il(r.x() == winGeo.x()), ir(r.right() == winGeo.right()),
-             it(invertTitle && r.y() == winGeo.y()), ib(r.bottom() == winGeo.bottom());
+            bool il(r.x() == winGeo.x()), ir(r.right() == winGeo.right()),
+                 it(invertTitle && r.y() == winGeo.y()), ib(r.bottom() == winGeo.bottom());
 
-        if (!il && geo.x() > parentRect.x()) {
-            il = (areas & Qt::LeftDockWidgetArea);
-            if (!il) {
-                QWidget *sibling = widget->parentWidget()->childAt(geo.x()-1, geo.y());
-                il = sibling && sibling->property("Virtuality.inverted").toBool();
+            if (!il && geo.x() > parentRect.x()) {
+                il = (areas & Qt::LeftDockWidgetArea);
+                if (!il)
+                    il = invertedSibling(parent, geo.x()-1, geo.y());
             }
-        }
-        if (!ir && geo.right() < parentRect.right()) {
-            ir = (areas & Qt::RightDockWidgetArea);
-            if (!ir) {
-                QWidget *sibling = widget->parentWidget()->childAt(geo.right()+1, geo.y());
-                ir = sibling && sibling->property("Virtuality.inverted").toBool();
+            if (!ir && geo.right() < parentRect.right()) {
+                ir = (areas & Qt::RightDockWidgetArea);
+                if (!ir)
+                    ir = invertedSibling(parent, geo.right()+1, geo.y());
             }
-        }
 
-        if (il || ir) {
-            if (!it && geo.y() > parentRect.y()) {
-                it = (areas & Qt::TopDockWidgetArea);
-                if (!it) {
-                    QWidget *sibling = widget->parentWidget()->childAt(geo.x(), geo.y()-1);
-                    it = sibling && sibling->property("Virtuality.inverted").toBool();
+            if (il || ir) {
+                if (!it && geo.y() > parentRect.y()) {
+                    it = (areas & Qt::TopDockWidgetArea);
+                    if (!it)
+                        it = invertedSibling(parent, geo.x(), geo.y()-1);
                 }
-            }
-            if (QWidget *dvc = dolphinViewContainer(appType == Dolphin, widget)) {
-                ib = config.invert.toolbars || config.invert.docks;
-                if (config.invert.toolbars) {
-                    foreach (QObject *o, dvc->children()) {
-                        if (QWidget *dsb = widgetOfClass("DolphinStatusBar", o)) {
-                            r.adjust(0,0,0, -dsb->height());
+                if (QWidget *dvc = dolphinViewContainer(appType == Dolphin, widget)) {
+                    ib = config.invert.toolbars || config.invert.docks;
+                    if (config.invert.toolbars) {
+                        foreach (QObject *o, dvc->children()) {
+                            if (QWidget *dsb = widgetOfClass("DolphinStatusBar", o)) {
+                                watchCorners(dsb);
+                                r.adjust(0,0,0, -dsb->height());
+                            }
                         }
                     }
-                }
-            } else if (!ib && geo.bottom() < parentRect.bottom()) {
-                ib = (areas & Qt::BottomDockWidgetArea);
-                if (!ib) {
-                    QWidget *sibling = widget->parentWidget()->childAt(geo.x(), geo.bottom()+1);
-                    ib = sibling && sibling->property("Virtuality.inverted").toBool();
+                } else if (!ib && geo.bottom() < parentRect.bottom()) {
+                    ib = (areas & Qt::BottomDockWidgetArea);
+                    if (!ib)
+                        ib = invertedSibling(parent, geo.x(), geo.bottom()+1);
                 }
             }
+            corners.rect = r;
+            corners.il = il; corners.ir = ir; corners.it = it; corners.ib = ib;
+        }
+
+        const QRect &r = corners.rect;
+        const bool il(corners.il), ir(corners.ir), it(corners.it), ib(corners.ib);
+        if (il || ir) {
             if (il) {
                 if (it)
                     painter->drawPixmap(r.x(), r.y(), mask, 0, 0, rnd, rnd);
@@ -358,7 +486,18 @@ Style::drawWindowBg(const QStyleOption *option, QPainter *painter, const QWidget
 //         p.fillRect( widget->rect(), Qt::black );
 //         p.end();
 //     }
-    painter->fillRect( widget->rect(), c );
+    // Qt clips PE_Widget (and we the translucent paint event) to the exposed region - a blinking
+    // cursor in a large dialog shall not fill the entire window
+    const QRegion exposed = painter->hasClipping() ? painter->clipRegion() & widget->rect() : QRegion(widget->rect());
+    if (exposed.isEmpty())
+        return;
+#if QT_VERSION >= 0x050800
+    for (const QRect &rect : exposed)
+        painter->fillRect(rect, c);
+#else
+    foreach (const QRect &rect, exposed.rects())
+        painter->fillRect(rect, c);
+#endif
 
     // Ensure ring texture --------------------------------------------------------
     if (widget->windowType() == Qt::Dialog && config.bg.ringOverlay) {
@@ -380,14 +519,15 @@ Style::drawWindowBg(const QStyleOption *option, QPainter *painter, const QWidget
             else
                 ringValue -= 24;
             const QColor grey(ringValue, ringValue, ringValue);
+            delete gs_overlay;
             switch (config.bg.ringOverlay) {
                 default:
-                case 1: createRingPix(255, ringValue); break;
-                case 2: createImperialPix(FX::blend(bgColor, grey, 10, 1)); break;
-                case 3: createTronPix(FX::blend(bgColor, grey, 10, 1)); break;
-                case 4: createPlasmaPix(FX::blend(bgColor, grey, 5, 1)); break;
-                case 5: createArtDecoPix(FX::blend(bgColor, grey, 20, 1), Qt::Horizontal); break;
-                case 6: createArtDecoPix(FX::blend(bgColor, grey, 20, 1), Qt::Vertical); break;
+                case 1: createOverlay(1, grey); break;
+                case 2:
+                case 3: createOverlay(config.bg.ringOverlay, FX::blend(bgColor, grey, 10, 1)); break;
+                case 4: createOverlay(4, FX::blend(bgColor, grey, 5, 1)); break;
+                case 5:
+                case 6: createOverlay(config.bg.ringOverlay, FX::blend(bgColor, grey, 20, 1)); break;
             }
             if (!ringResetTimer) {
                 ringResetTimer = new QTimer(const_cast<BE::Style*>(this));
@@ -397,21 +537,25 @@ Style::drawWindowBg(const QStyleOption *option, QPainter *painter, const QWidget
                 connect(ringResetTimer, SIGNAL(destroyed()), SLOT(resetRingPix()));
             }
         }
-        int x(widget->width()-gs_overlay->width()), y(0);
+        const QSize overlay = overlaySize(config.bg.ringOverlay);
+        int x(widget->width()-overlay.width()), y(0);
         switch (config.bg.ringOverlay) {
             case 6: x -= 32; // fall through
             case 1: break;
             default: x -= 32; // fall through
-            case 5: y = widget->height() - (gs_overlay->height() + 48); break;
+            case 5: y = widget->height() - (overlay.height() + 48); break;
         }
-        painter->drawPixmap(x, y, *gs_overlay);
+        if (exposed.intersects(QRect(QPoint(x, y), overlay)))
+            painter->drawPixmap(x, y, *gs_overlay);
         if (ringResetTimer)
             ringResetTimer->start(5000);
     }
     if (widget->testAttribute(Qt::WA_TranslucentBackground)) {
         const QVariant wdv = widget->property("BespinWindowHints");
         const int windowDecoration = wdv.isValid() ? wdv.toInt() : 0;
-        if ( windowDecoration & Rounded )
+        const int corner = cornerSize(config.frame.roundness);
+        if ( (windowDecoration & Rounded) &&
+             !widget->rect().adjusted(corner,corner,-corner,-corner).contains(exposed.boundingRect()) )
             shapeCorners( painter, widget->rect(), config.frame.roundness );
     }
 }
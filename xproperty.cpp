@@ -17,12 +17,19 @@
  */
 
 #include <QtDebug> // gets us Qt version also ;)
+#include <QList>
+#include <cstdlib>
+#include <cstring>
+#include "cyclequeue.h"
 #include "xproperty.h"
 
 
 using namespace BE;
 
 #include <X11/Xatom.h>
+#if QT_VERSION >= 0x050000
+#include <xcb/xcb.h>
+#endif
 #include "fixx11h.h"
 
 BLIB_EXPORT Atom XProperty::winData;
@@ -38,57 +45,221 @@ BLIB_EXPORT Atom XProperty::bespinShadow[2];
 BLIB_EXPORT Atom XProperty::netSupported;
 BLIB_EXPORT Atom XProperty::blockCompositing;
 
+#define N_ATOMS 11
+
 void
 XProperty::init()
 {
     static bool initialized = false;
     if (initialized)
         return;
-    winData = XInternAtom(BE_X11_DISPLAY, "BESPIN_WIN_DATA", False);
-    bgPics = XInternAtom(BE_X11_DISPLAY, "BESPIN_BG_PICS", False);
-    decoDim = XInternAtom(BE_X11_DISPLAY, "BESPIN_DECO_DIM", False);
-    pid = XInternAtom(BE_X11_DISPLAY, "_NET_WM_PID", False);
-    blurRegion = XInternAtom(BE_X11_DISPLAY, "_KDE_NET_WM_BLUR_BEHIND_REGION", False);
-    forceShadows = XInternAtom( BE_X11_DISPLAY, "_KDE_SHADOW_FORCE", False );
-    kwinShadow = XInternAtom( BE_X11_DISPLAY, "_KDE_NET_WM_SHADOW", False );
-    bespinShadow[0] = XInternAtom( BE_X11_DISPLAY, "BESPIN_SHADOW_SMALL", False );
-    bespinShadow[1] = XInternAtom( BE_X11_DISPLAY, "BESPIN_SHADOW_LARGE", False );
-    netSupported = XInternAtom( BE_X11_DISPLAY, "_NET_SUPPORTED", False );
-    blockCompositing = XInternAtom( BE_X11_DISPLAY, "_KDE_NET_WM_BLOCK_COMPOSITING", False );
+    const char *names[N_ATOMS] = { "BESPIN_WIN_DATA", "BESPIN_BG_PICS", "BESPIN_DECO_DIM", "_NET_WM_PID",
+                                   "_KDE_NET_WM_BLUR_BEHIND_REGION", "_KDE_SHADOW_FORCE", "_KDE_NET_WM_SHADOW",
+                                   "BESPIN_SHADOW_SMALL", "BESPIN_SHADOW_LARGE", "_NET_SUPPORTED",
+                                   "_KDE_NET_WM_BLOCK_COMPOSITING" };
+    Atom *atoms[N_ATOMS] = { &winData, &bgPics, &decoDim, &pid, &blurRegion, &forceShadows, &kwinShadow,
+                             &bespinShadow[0], &bespinShadow[1], &netSupported, &blockCompositing };
+    // one round trip for all of them
+#if QT_VERSION >= 0x050000
+    xcb_connection_t *c = BE_XCB_CONN;
+    xcb_intern_atom_cookie_t cookies[N_ATOMS];
+    for (int i = 0; i < N_ATOMS; ++i)
+        cookies[i] = xcb_intern_atom(c, false, strlen(names[i]), names[i]);
+    for (int i = 0; i < N_ATOMS; ++i) {
+        xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(c, cookies[i], NULL);
+        *atoms[i] = reply ? reply->atom : None;
+        free(reply);
+    }
+#else
+    Atom values[N_ATOMS];
+    XInternAtoms(BE_X11_DISPLAY, const_cast<char**>(names), N_ATOMS, False, values);
+    for (int i = 0; i < N_ATOMS; ++i)
+        *atoms[i] = values[i];
+#endif
     initialized = true;
 }
 
+typedef struct {
+    WId window;
+    Atom atom, type;
+    int format; // 0: delete
+    unsigned long n;
+    QByteArray data; // in wire format, ie. 32bit items for xcb
+} Write;
+
+static QList<Write> gs_writes;
+
+class WriteQueue : public CycleQueue
+{
+protected:
+    void process() { XProperty::flush(); }
+};
+static WriteQueue *gs_writeQueue = 0;
+
+static void
+enqueue(const Write &write)
+{
+    // only the last write to a property matters
+    bool replaced = false;
+    for (int i = 0; i < gs_writes.count(); ++i) {
+        if (gs_writes.at(i).window == write.window && gs_writes.at(i).atom == write.atom) {
+            gs_writes[i] = write;
+            replaced = true;
+            break;
+        }
+    }
+    if (!replaced)
+        gs_writes << write;
+    if (!gs_writeQueue)
+        gs_writeQueue = new WriteQueue;
+    gs_writeQueue->schedule();
+}
+
+void
+XProperty::flush()
+{
+    if (gs_writes.isEmpty())
+        return;
+#if QT_VERSION >= 0x050000
+    xcb_connection_t *c = BE_XCB_CONN;
+    for (int i = 0; i < gs_writes.count(); ++i) {
+        const Write &w = gs_writes.at(i);
+        if (w.format)
+            xcb_change_property(c, XCB_PROP_MODE_REPLACE, w.window, w.atom, w.type, w.format, w.n, w.data.constData());
+        else
+            xcb_delete_property(c, w.window, w.atom);
+    }
+    xcb_flush(c);
+#else
+    for (int i = 0; i < gs_writes.count(); ++i) {
+        const Write &w = gs_writes.at(i);
+        if (w.format)
+            XChangeProperty(BE_X11_DISPLAY, w.window, w.atom, w.type, w.format, PropModeReplace, (const uchar*)w.data.constData(), w.n);
+        else
+            XDeleteProperty(BE_X11_DISPLAY, w.window, w.atom);
+    }
+    XFlush(BE_X11_DISPLAY);
+#endif
+    gs_writes.clear();
+}
+
 void
 XProperty::setAtom(WId window, Atom atom)
 {
-    const char *data = "1";
-    XChangeProperty(BE_X11_DISPLAY, window, atom, XA_ATOM, 32, PropModeReplace, (uchar*)data, 1 );
+    const unsigned long data = 1;
+    queue(window, atom, (const uchar*)&data, ATOM, 1);
 }
 
-unsigned long
-XProperty::handleProperty(WId window, Atom atom, uchar **data, Type type, unsigned long n)
+void
+XProperty::queue(WId window, Atom atom, const uchar *data, Type type, unsigned long n)
 {
-    int format = (type == LONG ? 32 : type);
-    Atom xtype = (type == ATOM ? XA_ATOM : XA_CARDINAL);
-    if (*data) // this is ok, internally used only
+    Write w;
+    w.window = window;
+    w.atom = atom;
+    w.type = (type == ATOM ? XA_ATOM : XA_CARDINAL);
+    w.format = (type == LONG ? 32 : type);
+    w.n = n;
+#if QT_VERSION >= 0x050000
+    if (w.format == 32) { // longs -> 32bit
+        w.data.resize(4*n);
+        quint32 *wire = reinterpret_cast<quint32*>(w.data.data());
+        const unsigned long *longs = reinterpret_cast<const unsigned long*>(data);
+        for (unsigned long i = 0; i < n; ++i)
+            wire[i] = quint32(longs[i]);
+    } else
+#endif
     {
-        XChangeProperty(BE_X11_DISPLAY, window, atom, xtype, format, PropModeReplace, *data, n );
-        XSync(BE_X11_DISPLAY, False);
-        return 0;
+        w.data = QByteArray(reinterpret_cast<const char*>(data), (w.format == 32 ? sizeof(long) : w.format/8)*n);
     }
-    int result, de; //dead end
-    unsigned long nn, de2;
-    int nmax = n ? n : 0xffffffff;
-    result = XGetWindowProperty(BE_X11_DISPLAY, window, atom, 0L, nmax, False, xtype, &de2, &de, &nn, &de2, data);
-    if (result != Success || *data == NULL || (n > 0 && n != nn))
-        *data = NULL; // superflous?!?
-    return nn;
+    enqueue(w);
 }
 
 void
 XProperty::remove(WId window, Atom atom)
 {
-    XDeleteProperty(BE_X11_DISPLAY, window, atom);
+    Write w;
+    w.window = window;
+    w.atom = atom;
+    w.type = None;
+    w.format = 0;
+    w.n = 0;
+    enqueue(w);
+}
+
+XProperty::Request
+XProperty::sendRequest(WId window, Atom atom, Type type, unsigned long n)
+{
+    flush(); // the server shall answer with what we wrote
+    Request request;
+    request.window = window;
+    request.atom = atom;
+    request.type = type;
+    request.n = n;
+#if QT_VERSION >= 0x050000
+    xcb_connection_t *c = BE_XCB_CONN;
+    request.sequence = xcb_get_property(c, false, window, atom, type == ATOM ? XA_ATOM : XA_CARDINAL,
+                                        0, n ? n : 0xffffffff).sequence;
+    xcb_flush(c);
+#else
+    request.sequence = 1; // Xlib cannot split it, fetchReply() does the round trip
+#endif
+    return request;
+}
+
+unsigned long
+XProperty::fetchReply(Request &request, uchar **data, bool wait)
+{
+    *data = NULL;
+    if (!request.sequence)
+        return 0;
+    const int format = (request.type == LONG ? 32 : request.type);
+    unsigned long nn = 0;
+#if QT_VERSION >= 0x050000
+    xcb_connection_t *c = BE_XCB_CONN;
+    xcb_get_property_reply_t *reply = NULL;
+    if (wait) {
+        xcb_get_property_cookie_t cookie = { request.sequence };
+        reply = xcb_get_property_reply(c, cookie, NULL);
+    } else {
+        void *r = NULL;
+        xcb_generic_error_t *error = NULL;
+        if (!xcb_poll_for_reply(c, request.sequence, &r, &error))
+            return 0; // still pending
+        reply = static_cast<xcb_get_property_reply_t*>(r);
+        free(error);
+    }
+    request.sequence = 0;
+    if (!reply)
+        return 0;
+    nn = xcb_get_property_value_length(reply)/(format/8);
+    if (reply->format == format && nn && !(request.n > 0 && request.n != nn)) {
+        const void *value = xcb_get_property_value(reply);
+        if (format == 32) { // 32bit -> longs, like Xlib
+            unsigned long *longs = static_cast<unsigned long*>(malloc(nn*sizeof(long)));
+            for (unsigned long i = 0; i < nn; ++i)
+                longs[i] = static_cast<const quint32*>(value)[i];
+            *data = reinterpret_cast<uchar*>(longs);
+        } else {
+            *data = static_cast<uchar*>(malloc(nn*format/8));
+            memcpy(*data, value, nn*format/8);
+        }
+    }
+    free(reply);
+#else
+    Q_UNUSED(wait);
+    request.sequence = 0;
+    int result, de; //dead end
+    unsigned long de2;
+    int nmax = request.n ? request.n : 0xffffffff;
+    result = XGetWindowProperty(BE_X11_DISPLAY, request.window, request.atom, 0L, nmax, False,
+                                request.type == ATOM ? XA_ATOM : XA_CARDINAL, &de2, &de, &nn, &de2, data);
+    if (result != Success || *data == NULL || (request.n > 0 && request.n != nn)) {
+        if (*data)
+            XFree(*data);
+        *data = NULL;
+    }
+#endif
+    return nn;
 }
 
 #if 0
@@ -54,10 +54,25 @@ typedef struct _WindowPics
     Picture topTile, btmTile, cnrTile, lCorner, rCorner;
 } WindowPics;
 
+/**
+ * Writes (set, setAtom, remove) are queued and go out together once per event loop cycle,
+ * without syncing - unless a read (or flush()) needs them out earlier.
+ * Reads can be split: request() sends the query, reply() picks up the answer - with wait = false
+ * it returns 0 and keeps the request pending if the server did not answer yet.
+ * Returned data is owned by the caller, release it with XFree(). Format 32 data is an array of
+ * longs, like Xlib does it.
+ */
 class BLIB_EXPORT XProperty
 {
 public:
     enum Type { LONG = 1, BYTE = 8, WORD = 16, ATOM = 32 };
+    typedef struct {
+        WId window;
+        Atom atom;
+        Type type;
+        unsigned long n;
+        uint sequence; // 0: nothing pending
+    } Request;
     static Atom winData, bgPics, decoDim, pid, blurRegion,
                 forceShadows, kwinShadow, bespinShadow[2],
                 netSupported, blockCompositing;
@@ -65,10 +80,20 @@ public:
 
     template <typename T> inline static T *get(WId window, Atom atom, Type type, unsigned long *n = 0)
     {
-        unsigned long nn = n ? *n : 1;
+        Request r = request<T>(window, atom, type, n ? *n : 1);
+        return reply<T>(r, n);
+    }
+
+    template <typename T> inline static Request request(WId window, Atom atom, Type type, unsigned long n = 0)
+    {
+        return sendRequest(window, atom, type, _n<T>(type, n));
+    }
+
+    template <typename T> inline static T *reply(Request &request, unsigned long *n = 0, bool wait = true)
+    {
         T *data = 0;
         T **data_p = &data;
-        nn = handleProperty(window, atom, (uchar**)data_p, type, _n<T>(type, nn));
+        const unsigned long nn = fetchReply(request, (uchar**)data_p, wait);
         if (n)
             *n = nn;
         return data;
@@ -77,20 +102,23 @@ public:
     template <typename T> inline static void set(WId window, Atom atom, T *data, Type type, unsigned long n = 1)
     {
         if (!data) return;
-        T **data_p = &data;
-        handleProperty(window, atom, (uchar**)data_p, type, _n<T>(type, n));
+        queue(window, atom, (const uchar*)data, type, _n<T>(type, n));
     }
 
     static void remove(WId window, Atom atom);
     static void setAtom(WId window, Atom atom);
+    static void flush();
 private:
-    static unsigned long handleProperty(WId window, Atom atom, uchar **data, Type type, unsigned long n);
+    static void queue(WId window, Atom atom, const uchar *data, Type type, unsigned long n);
+    static Request sendRequest(WId window, Atom atom, Type type, unsigned long n);
+    static unsigned long fetchReply(Request &request, uchar **data, bool wait);
     template <typename T> inline static long _n(Type type, unsigned long n)
     {
         if (n < 1)
             return 0;
         unsigned long _n = n*sizeof(T)*8;
-        _n /= (type == XProperty::LONG) ? 8*sizeof(long int) : (uint)type;
+        // format 32 items are longs on the client side
+        _n /= (type == XProperty::LONG || type == XProperty::ATOM) ? 8*sizeof(long int) : (uint)type;
         return _n ? _n : 1L;
     }
 };
@@ -99,9 +127,11 @@ inline bool isPlatformX11() {
 #if QT_VERSION < 0x050000
     return true;
 #elif QT_VERSION >= 0x060200
-    return bool(qGuiApp->nativeInterface<QNativeInterface::QX11Application>());
+    static const bool x11 = bool(qGuiApp->nativeInterface<QNativeInterface::QX11Application>());
+    return x11;
 #else
-    return QX11Info::isPlatformX11();
+    static const bool x11 = QX11Info::isPlatformX11();
+    return x11;
 #endif
 }
 }